@@ -0,0 +1,478 @@
+// throughput and round-trip latency of the lockless queues
+//
+// usage: xroost_bench_queues [--pairs=P:C,...] [--queues=NAME,...]
+//                            [--payloads=SIZE,...] [--items=N]
+//                            [--rtt-samples=N] [--json=FILE]
+//
+// every queue is run with every payload size for every pair of cpus, the
+// producer is pinned to the cpu P and the consumer to the cpu C; the results
+// go to FILE (stdout by default) as JSON, a summary goes to stderr
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <xroost/lockless/detail.hpp>
+#include <xroost/lockless/mpmcqueue.hpp>
+#include <xroost/lockless/shm_spscqueue.hpp>
+#include <xroost/lockless/spmcbroadcast.hpp>
+#include <xroost/lockless/spmcqueue.hpp>
+#include <xroost/lockless/spscqueue.hpp>
+#include <xroost/lockless/unbounded_spscqueue.hpp>
+
+namespace {
+
+using namespace xroost::lockless;
+
+constexpr size_t capacity{1024};
+
+template <size_t Size> struct payload {
+  static_assert(!(Size < sizeof(uint64_t)));
+  uint64_t seq;
+  std::array<std::byte, Size - sizeof(uint64_t)> pad;
+};
+
+template <> struct payload<sizeof(uint64_t)> {
+  uint64_t seq;
+};
+
+// log-linear buckets in the fashion of HdrHistogram: every value is tracked
+// to within 1/2^sub_bits of itself
+class histogram {
+public:
+  static constexpr unsigned sub_bits{5};
+
+  void record(uint64_t v) noexcept {
+    ++counts_[index_of(v)];
+    ++total_;
+    sum_ += v;
+    min_ = std::min(min_, v);
+    max_ = std::max(max_, v);
+  }
+
+  [[nodiscard]] uint64_t total() const noexcept { return total_; }
+  [[nodiscard]] uint64_t min() const noexcept { return total_ ? min_ : 0; }
+  [[nodiscard]] uint64_t max() const noexcept { return max_; }
+  [[nodiscard]] double mean() const noexcept {
+    return total_ ? static_cast<double>(sum_) / total_ : 0;
+  }
+
+  // the highest value of the bucket the p-th percentile falls into
+  [[nodiscard]] uint64_t percentile(double p) const noexcept {
+    auto const rank{std::max(
+        uint64_t{1}, static_cast<uint64_t>(std::ceil(p / 100 * total_)))};
+    uint64_t seen{0};
+    for (size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (!(seen < rank))
+        return std::min(highest_of(i), max_);
+    }
+    return max_;
+  }
+
+private:
+  static constexpr size_t sub_count{size_t{1} << sub_bits};
+
+  static size_t index_of(uint64_t v) noexcept {
+    if (v < sub_count)
+      return v;
+    auto const e{static_cast<unsigned>(std::bit_width(v)) - 1 - sub_bits};
+    return e * sub_count + (v >> e);
+  }
+
+  static uint64_t highest_of(size_t i) noexcept {
+    if (i < sub_count)
+      return i;
+    auto const e{i / sub_count - 1};
+    auto const m{i % sub_count + sub_count};
+    return ((m + 1) << e) - 1;
+  }
+
+  std::array<uint64_t, (65 - sub_bits) * sub_count> counts_{};
+  uint64_t total_{0};
+  uint64_t sum_{0};
+  uint64_t min_{UINT64_MAX};
+  uint64_t max_{0};
+};
+
+// uniform access to the queues: push reports failure where it can fail, pop
+// reads as the consumer 0 where there are several of them
+template <typename Q, typename T> bool try_push(Q &q, T const &v) {
+  if constexpr (requires { { q.push(v) } -> std::same_as<bool>; }) {
+    return q.push(v);
+  } else {
+    q.push(v);
+    return true;
+  }
+}
+
+template <typename Q> auto try_pop(Q &q) {
+  if constexpr (requires { q.pop(size_t{0}); })
+    return q.pop(0);
+  else
+    return q.pop();
+}
+
+// spins for a while and gives the cpu away then, so that a producer and a
+// consumer sharing a cpu make progress
+class backoff {
+public:
+  void operator()() noexcept {
+    if (spins_ < 64) {
+      ++spins_;
+      xroost::detail::cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  uint32_t spins_{0};
+};
+
+template <typename Q, typename T> void push(Q &q, T const &v) {
+  for (backoff wait; !try_push(q, v);)
+    wait();
+}
+
+template <typename Q> auto pop(Q &q) {
+  for (backoff wait;; wait()) {
+    if (auto v{try_pop(q)})
+      return *v;
+  }
+}
+
+bool pin(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+long topology(int cpu, char const *what) {
+  std::ifstream f{"/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                  "/topology/" + what};
+  long v{-1};
+  f >> v;
+  return v;
+}
+
+std::string placement(int producer, int consumer) {
+  if (producer == consumer)
+    return "same-cpu";
+
+  auto const pp{topology(producer, "physical_package_id")};
+  auto const cp{topology(consumer, "physical_package_id")};
+  if (pp < 0 || cp < 0)
+    return "unknown";
+  if (pp != cp)
+    return "cross-socket";
+  if (topology(producer, "core_id") == topology(consumer, "core_id"))
+    return "smt-sibling";
+  return "same-socket";
+}
+
+struct cpu_pair {
+  int producer;
+  int consumer;
+};
+
+struct options {
+  std::vector<cpu_pair> pairs;
+  std::vector<std::string> queues;
+  std::vector<size_t> payloads;
+  uint64_t items{10'000'000};
+  uint64_t rtt_samples{1'000'000};
+  std::string json;
+};
+
+struct throughput_result {
+  double seconds;
+  bool pinned;
+};
+
+// the producer pushes the items as fast as it can, the consumer pops them and
+// checks they come in order; timed by the consumer from the start signal to
+// the last item
+template <typename T, typename Q>
+throughput_result measure_throughput(Q &q, cpu_pair cpus, uint64_t items) {
+  std::atomic_int ready{0};
+  std::atomic_bool pinned{true};
+  std::chrono::steady_clock::duration elapsed{};
+
+  auto const start{[&](int cpu) {
+    if (!pin(cpu))
+      pinned.store(false, std::memory_order_relaxed);
+    ready.fetch_add(1, std::memory_order_acq_rel);
+    for (backoff wait; ready.load(std::memory_order_acquire) < 2;)
+      wait();
+  }};
+
+  std::thread consumer{[&] {
+    start(cpus.consumer);
+    auto const t0{std::chrono::steady_clock::now()};
+    for (uint64_t i = 0; i < items; ++i) {
+      if (pop(q).seq != i) [[unlikely]] {
+        std::cerr << "items out of order\n";
+        std::abort();
+      }
+    }
+    elapsed = std::chrono::steady_clock::now() - t0;
+  }};
+
+  start(cpus.producer);
+  T v{};
+  for (uint64_t i = 0; i < items; ++i) {
+    v.seq = i;
+    push(q, v);
+  }
+  consumer.join();
+
+  return {std::chrono::duration<double>(elapsed).count(),
+          pinned.load(std::memory_order_relaxed)};
+}
+
+// the producer sends an item through the first queue and waits for it to
+// come back through the second one, the consumer echoes the items
+template <typename T, typename Q>
+histogram measure_rtt(Q &ping, Q &pong, cpu_pair cpus, uint64_t samples) {
+  histogram h;
+  auto const warmup{std::min(samples, uint64_t{10'000})};
+
+  std::thread echo{[&] {
+    pin(cpus.consumer);
+    for (uint64_t i = 0; i < warmup + samples; ++i)
+      push(pong, pop(ping));
+  }};
+
+  pin(cpus.producer);
+  T v{};
+  for (uint64_t i = 0; i < warmup + samples; ++i) {
+    v.seq = i;
+    auto const t0{std::chrono::steady_clock::now()};
+    push(ping, v);
+    pop(pong);
+    auto const t1{std::chrono::steady_clock::now()};
+    if (!(i < warmup))
+      h.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                   .count());
+  }
+  echo.join();
+
+  return h;
+}
+
+template <typename T, typename Make>
+void run(std::ostream &json, bool &first, std::string_view name,
+         options const &opts, Make make) {
+  for (auto const cpus : opts.pairs) {
+    auto q{make()};
+    auto const tp{measure_throughput<T>(*q, cpus, opts.items)};
+
+    auto ping{make()};
+    auto pong{make()};
+    auto const h{measure_rtt<T>(*ping, *pong, cpus, opts.rtt_samples)};
+
+    auto const items_per_sec{opts.items / tp.seconds};
+
+    std::cerr << name << " payload " << sizeof(T) << " cpus " << cpus.producer
+              << ':' << cpus.consumer << ": " << items_per_sec / 1e6
+              << " Mitems/s, rtt p50 " << h.percentile(50) << " ns, p99 "
+              << h.percentile(99) << " ns\n";
+
+    json << (first ? "\n" : ",\n");
+    first = false;
+    json << "    {\"queue\": \"" << name << "\", \"payload\": " << sizeof(T)
+         << ", \"producer_cpu\": " << cpus.producer
+         << ", \"consumer_cpu\": " << cpus.consumer << ", \"placement\": \""
+         << placement(cpus.producer, cpus.consumer) << "\", \"pinned\": "
+         << (tp.pinned ? "true" : "false") << ",\n"
+         << "     \"throughput\": {\"items\": " << opts.items
+         << ", \"seconds\": " << tp.seconds
+         << ", \"items_per_sec\": " << items_per_sec
+         << ", \"bytes_per_sec\": " << items_per_sec * sizeof(T) << "},\n"
+         << "     \"rtt_ns\": {\"samples\": " << h.total()
+         << ", \"min\": " << h.min() << ", \"mean\": " << h.mean()
+         << ", \"p50\": " << h.percentile(50)
+         << ", \"p90\": " << h.percentile(90)
+         << ", \"p99\": " << h.percentile(99)
+         << ", \"p99.9\": " << h.percentile(99.9)
+         << ", \"p99.99\": " << h.percentile(99.99)
+         << ", \"max\": " << h.max() << "}}";
+  }
+}
+
+template <typename T>
+void run_all(std::ostream &json, bool &first, options const &opts) {
+  auto const wanted{[&](std::string_view name) {
+    return opts.queues.empty() ||
+           std::ranges::find(opts.queues, name) != opts.queues.end();
+  }};
+
+  if (wanted("static_spscqueue"))
+    run<T>(json, first, "static_spscqueue", opts, [] {
+      return std::make_unique<static_spscqueue<T, capacity>>();
+    });
+  if (wanted("spscqueue"))
+    run<T>(json, first, "spscqueue", opts,
+           [] { return std::make_unique<spscqueue<T>>(capacity); });
+  if (wanted("unbounded_spscqueue"))
+    run<T>(json, first, "unbounded_spscqueue", opts,
+           [] { return std::make_unique<unbounded_spscqueue<T>>(); });
+  if (wanted("shm_spscqueue"))
+    run<T>(json, first, "shm_spscqueue", opts, [] {
+      return std::unique_ptr<shm_spscqueue<T>>(new shm_spscqueue<T>(
+          shm_spscqueue<T>::create_anonymous(capacity)));
+    });
+  if (wanted("static_spmcqueue"))
+    run<T>(json, first, "static_spmcqueue", opts, [] {
+      return std::make_unique<static_spmcqueue<T, capacity>>();
+    });
+  if (wanted("spmcqueue"))
+    run<T>(json, first, "spmcqueue", opts,
+           [] { return std::make_unique<spmcqueue<T>>(capacity); });
+  if (wanted("static_mpmcqueue"))
+    run<T>(json, first, "static_mpmcqueue", opts, [] {
+      return std::make_unique<static_mpmcqueue<T, capacity>>();
+    });
+  if (wanted("mpmcqueue"))
+    run<T>(json, first, "mpmcqueue", opts,
+           [] { return std::make_unique<mpmcqueue<T>>(capacity); });
+  if (wanted("spmcbroadcast"))
+    run<T>(json, first, "spmcbroadcast", opts, [] {
+      auto q{std::make_unique<spmcbroadcast<T>>(capacity, 1)};
+      // becomes the consumer 0
+      q->register_consumer();
+      return q;
+    });
+}
+
+std::vector<std::string_view> split(std::string_view s, char sep) {
+  std::vector<std::string_view> parts;
+  while (!s.empty()) {
+    auto const pos{s.find(sep)};
+    parts.push_back(s.substr(0, pos));
+    s.remove_prefix(pos == s.npos ? s.size() : pos + 1);
+  }
+  return parts;
+}
+
+template <typename I> I to_number(std::string_view s) {
+  I v{};
+  if (auto const [p, ec]{std::from_chars(s.data(), s.data() + s.size(), v)};
+      ec != std::errc{} || p != s.data() + s.size()) {
+    std::cerr << "invalid number '" << s << "'\n";
+    std::exit(EXIT_FAILURE);
+  }
+  return v;
+}
+
+options parse(int argc, char *argv[]) {
+  options opts;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view const arg{argv[i]};
+    auto const eq{arg.find('=')};
+    auto const key{arg.substr(0, eq)};
+    auto const value{eq == arg.npos ? std::string_view{} : arg.substr(eq + 1)};
+
+    if ("--pairs" == key) {
+      for (auto const pair : split(value, ',')) {
+        auto const cpus{split(pair, ':')};
+        if (cpus.size() != 2) {
+          std::cerr << "invalid cpu pair '" << pair << "'\n";
+          std::exit(EXIT_FAILURE);
+        }
+        opts.pairs.push_back(
+            {to_number<int>(cpus[0]), to_number<int>(cpus[1])});
+      }
+    } else if ("--queues" == key) {
+      for (auto const name : split(value, ','))
+        opts.queues.emplace_back(name);
+    } else if ("--payloads" == key) {
+      for (auto const size : split(value, ','))
+        opts.payloads.push_back(to_number<size_t>(size));
+    } else if ("--items" == key) {
+      opts.items = to_number<uint64_t>(value);
+    } else if ("--rtt-samples" == key) {
+      opts.rtt_samples = to_number<uint64_t>(value);
+    } else if ("--json" == key) {
+      opts.json = value;
+    } else {
+      std::cerr << "unknown option '" << arg << "'\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (opts.pairs.empty())
+    opts.pairs.push_back({0, std::thread::hardware_concurrency() > 1 ? 1 : 0});
+  if (opts.payloads.empty())
+    opts.payloads = {8, 64, 256};
+
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  auto const opts{parse(argc, argv)};
+
+  std::ofstream file;
+  if (!opts.json.empty()) {
+    file.open(opts.json);
+    if (!file) {
+      std::cerr << "cannot open '" << opts.json << "'\n";
+      return EXIT_FAILURE;
+    }
+  }
+  auto &json{opts.json.empty() ? std::cout : file};
+  json.precision(9);
+
+  json << "{\n  \"version\": \"" << XROOST_VERSION << "\",\n"
+       << "  \"capacity\": " << capacity << ",\n"
+       << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+       << ",\n  \"results\": [";
+
+  bool first{true};
+  for (auto const size : opts.payloads) {
+    switch (size) {
+    case 8:
+      run_all<payload<8>>(json, first, opts);
+      break;
+    case 64:
+      run_all<payload<64>>(json, first, opts);
+      break;
+    case 256:
+      run_all<payload<256>>(json, first, opts);
+      break;
+    case 1024:
+      run_all<payload<1024>>(json, first, opts);
+      break;
+    default:
+      std::cerr << "payload " << size << " is not one of 8, 64, 256, 1024\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  json << "\n  ]\n}\n";
+
+  return EXIT_SUCCESS;
+}
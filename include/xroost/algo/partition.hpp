@@ -1,17 +1,23 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
 #include <concepts>
 #include <iterator>
 #include <ranges>
 #include <utility>
 
-namespace xroost::algo {
+namespace xroost::detail {
 
-template <std::permutable I, std::sentinel_for<I> S,
-          typename Proj = std::identity,
-          std::indirect_unary_predicate<std::projected<I, Proj>> Pred =
-              std::ranges::less>
-I partition(I first, S last, Pred pred = {}, Proj proj = {}) {
+// the items tested at once at either end by block_partition
+inline constexpr size_t partition_block{64};
+
+template <std::permutable I, std::sentinel_for<I> S, typename Pred,
+          typename Proj>
+I partition_items(I first, S last, Pred &pred, Proj &proj) {
   first =
       std::ranges::find_if_not(std::ranges::subrange{first, last}, pred, proj);
   if (first == last)
@@ -25,6 +31,76 @@ I partition(I first, S last, Pred pred = {}, Proj proj = {}) {
   return first;
 }
 
+// BlockQuicksort's partition: a block at the left end and one at the right
+// end are tested item by item without branching on the outcome, the offsets
+// of the items misplaced are written down every time and the number of them
+// is advanced by the outcome; the items misplaced are then swapped pairwise.
+// A block is replaced once all of its items misplaced have been swapped,
+// whatever is left between the blocks in the end is partitioned item by item
+template <std::random_access_iterator I, typename Pred, typename Proj>
+I partition_blocks(I first, I last, Pred &pred, Proj &proj) {
+  constexpr auto block{static_cast<std::iter_difference_t<I>>(partition_block)};
+
+  std::array<uint8_t, partition_block> offsets_l, offsets_r;
+  size_t start_l{0}, start_r{0}, count_l{0}, count_r{0};
+
+  while (last - first > 2 * block) {
+    if (0 == count_l) {
+      start_l = 0;
+      for (size_t i = 0; i < partition_block; ++i) {
+        offsets_l[count_l] = static_cast<uint8_t>(i);
+        count_l += !pred(proj(first[i]));
+      }
+    }
+    if (0 == count_r) {
+      start_r = 0;
+      for (size_t i = 0; i < partition_block; ++i) {
+        offsets_r[count_r] = static_cast<uint8_t>(i);
+        count_r += static_cast<bool>(pred(proj(*(last - 1 - i))));
+      }
+    }
+
+    auto const count{std::min(count_l, count_r)};
+    for (size_t i = 0; i < count; ++i) {
+      std::iter_swap(first + offsets_l[start_l + i],
+                     last - 1 - offsets_r[start_r + i]);
+    }
+    start_l += count;
+    start_r += count;
+    count_l -= count;
+    count_r -= count;
+
+    if (0 == count_l)
+      first += block;
+    if (0 == count_r)
+      last -= block;
+  }
+
+  return partition_items(first, last, pred, proj);
+}
+
+} // namespace xroost::detail
+
+namespace xroost::algo {
+
+// the items of random access ranges are partitioned by blocks, see
+// detail::partition_blocks, so that an unpredictable predicate does not
+// cost a branch misprediction every other item
+template <std::permutable I, std::sentinel_for<I> S,
+          typename Proj = std::identity,
+          std::indirect_unary_predicate<std::projected<I, Proj>> Pred =
+              std::ranges::less>
+I partition(I first, S last, Pred pred = {}, Proj proj = {}) {
+  if constexpr (std::random_access_iterator<I>) {
+    first = std::ranges::find_if_not(std::ranges::subrange{first, last}, pred,
+                                     proj);
+    return detail::partition_blocks(first, std::ranges::next(first, last),
+                                    pred, proj);
+  } else {
+    return detail::partition_items(first, last, pred, proj);
+  }
+}
+
 template <std::ranges::forward_range Range, typename Proj = std::identity,
           std::indirect_unary_predicate<
               std::projected<std::ranges::iterator_t<Range>, Proj>>
@@ -4,43 +4,150 @@
 
 #include <algorithm>
 #include <concepts>
+#include <functional>
 #include <iterator>
 #include <ranges>
-#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <xroost/algo/sorting/radix_sort.hpp>
+
+namespace xroost::detail {
+
+// integers and enumerations
+template <typename T>
+concept counting_key =
+    (std::integral<T> && !std::same_as<T, bool>) || std::is_enum_v<T>;
+
+// the orders counting_sort is able to sort in
+template <typename Comp>
+concept counting_order = std::same_as<Comp, std::ranges::less> ||
+                         std::same_as<Comp, std::ranges::greater>;
+
+template <counting_key T> constexpr auto counting_bits(T key) noexcept {
+  if constexpr (std::is_enum_v<T>)
+    return radix_bits(static_cast<std::underlying_type_t<T>>(key));
+  else
+    return radix_bits(key);
+}
+
+// key ranges narrower than that are counted whatever the number of items
+inline constexpr size_t counting_sort_min_range{256};
+
+} // namespace xroost::detail
+
 namespace xroost::algo {
 
+// the scratch memory of counting_sort, kept from one sort to another not to
+// be allocated every time
+template <typename T> struct counting_sort_buffer {
+  std::vector<T> items;
+  std::vector<size_t> counts;
+};
+
+// stable sort of the items by their projected keys, integers or enums, in
+// the order of comp: the items are moved into the buffer while their keys
+// are counted, the counts are summed up into the positions of the keys
+// and the items are moved back there. Keys spanning a range wider than the
+// number of items, and than detail::counting_sort_min_range, are sorted by
+// lsd_radix_sort instead not to count mostly absent keys
 template <std::random_access_iterator I, std::sentinel_for<I> S,
           typename Comp = std::ranges::less, typename Proj = std::identity>
-  requires(std::integral<typename std::iterator_traits<I>::value_type> &&
-           std::sortable<I, Comp, Proj>)
-void counting_sort(I first, S last, Comp comp = {}, Proj proj = {}) {
-  if (std::ranges::distance(first, last) < 2)
+  requires(std::sortable<I, Comp, Proj> &&
+           detail::counting_key<detail::radix_key_t<I, Proj>> &&
+           detail::counting_order<Comp>)
+void counting_sort(I first, S last,
+                   counting_sort_buffer<std::iter_value_t<I>> &buffer,
+                   Comp comp = {}, Proj proj = {}) {
+  constexpr bool descending{std::same_as<Comp, std::ranges::greater>};
+
+  auto const end{std::ranges::next(first, last)};
+  auto const size{static_cast<size_t>(end - first)};
+  if (size < 2)
+    return;
+
+  auto const key{[&proj](auto const &v) {
+    return detail::counting_bits(std::invoke(proj, v));
+  }};
+
+  auto lo{key(*first)}, hi{lo};
+  for (auto it{first + 1}; it != end; ++it) {
+    auto const k{key(*it)};
+    lo = std::min(lo, k);
+    hi = std::max(hi, k);
+  }
+  if (lo == hi)
     return;
 
-  I min_it, max_it;
-  std::tie(min_it, max_it) = std::minmax_element(first, last);
-  if (last == min_it || last == max_it || *max_it == *min_it)
+  if (!(static_cast<size_t>(hi - lo) <
+        std::max(size, detail::counting_sort_min_range))) {
+    if constexpr (std::default_initializable<std::iter_value_t<I>>) {
+      lsd_radix_sort(first, end, [&key](auto const &v) {
+        return descending ? static_cast<decltype(key(v))>(~key(v)) : key(v);
+      });
+    } else {
+      std::ranges::stable_sort(first, end, std::move(comp), std::move(proj));
+    }
     return;
+  }
+
+  auto const index{[&key, lo, hi](auto const &v) {
+    return static_cast<size_t>(descending ? hi - key(v) : key(v) - lo);
+  }};
+
+  auto &items{buffer.items};
+  auto &counts{buffer.counts};
+  items.clear();
+  items.reserve(size);
+  counts.assign(static_cast<size_t>(hi - lo) + 1, 0);
+
+  for (auto it{first}; it != end; ++it) {
+    items.push_back(std::ranges::iter_move(it));
+    ++counts[index(items.back())];
+  }
 
-  std::vector<size_t> values(*max_it - *min_it + 1);
-  auto const min_val{*min_it};
-  std::for_each(first, last,
-                [&values, min_val](auto value) { ++values[value - min_val]; });
+  for (size_t i = 0, offset = 0; i < counts.size(); ++i)
+    offset += std::exchange(counts[i], offset);
 
-  auto it{first};
-  for (auto vit{values.begin()}; values.end() != vit; ++vit)
-    it = std::fill_n(it, *vit, min_val + std::distance(values.begin(), vit));
+  for (auto &item : items)
+    first[counts[index(item)]++] = std::move(item);
+  items.clear();
+}
+
+template <std::random_access_iterator I, std::sentinel_for<I> S,
+          typename Comp = std::ranges::less, typename Proj = std::identity>
+  requires(std::sortable<I, Comp, Proj> &&
+           detail::counting_key<detail::radix_key_t<I, Proj>> &&
+           detail::counting_order<Comp>)
+void counting_sort(I first, S last, Comp comp = {}, Proj proj = {}) {
+  counting_sort_buffer<std::iter_value_t<I>> buffer;
+  counting_sort(first, last, buffer, std::move(comp), std::move(proj));
+}
+
+template <std::ranges::random_access_range Range,
+          typename Comp = std::ranges::less, typename Proj = std::identity>
+  requires(std::sortable<std::ranges::iterator_t<Range>, Comp, Proj> &&
+           detail::counting_key<
+               detail::radix_key_t<std::ranges::iterator_t<Range>, Proj>> &&
+           detail::counting_order<Comp>)
+void counting_sort(Range &&rng,
+                   counting_sort_buffer<std::ranges::range_value_t<Range>>
+                       &buffer,
+                   Comp comp = {}, Proj proj = {}) {
+  counting_sort(std::ranges::begin(rng), std::ranges::end(rng), buffer,
+                std::move(comp), std::move(proj));
 }
 
 template <std::ranges::random_access_range Range,
           typename Comp = std::ranges::less, typename Proj = std::identity>
-  requires std::sortable<std::ranges::iterator_t<Range>, Comp, Proj>
-constexpr void counting_sort(Range &&rng, Comp comp = {}, Proj proj = {}) {
-  counting_sort(std::ranges::begin(rng), std::ranges::end(rng), std::move(comp),
-                std::move(proj));
+  requires(std::sortable<std::ranges::iterator_t<Range>, Comp, Proj> &&
+           detail::counting_key<
+               detail::radix_key_t<std::ranges::iterator_t<Range>, Proj>> &&
+           detail::counting_order<Comp>)
+void counting_sort(Range &&rng, Comp comp = {}, Proj proj = {}) {
+  counting_sort(std::ranges::begin(rng), std::ranges::end(rng),
+                std::move(comp), std::move(proj));
 }
 
 } // namespace xroost::algo
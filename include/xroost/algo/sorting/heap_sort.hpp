@@ -19,7 +19,7 @@ template <std::ranges::random_access_range Range,
   requires std::sortable<std::ranges::iterator_t<Range>, Comp, Proj>
 constexpr std::ranges::borrowed_iterator_t<Range>
 make_heap(Range &&rng, Comp comp = {}, Proj proj = {}) {
-  for (auto i = 1z; i < std::ranges::size(rng); ++i) {
+  for (auto i = std::ptrdiff_t{1}; i < std::ranges::ssize(rng); ++i) {
     for (auto k = i, j = k % 2 ? k / 2 : k / 2 - 1; !(j < 0);
          k = j, j = k % 2 ? k / 2 : k / 2 - 1) {
       if (comp(proj(rng[j]), proj(rng[k]))) {
@@ -47,9 +47,9 @@ pop_heap(Range &&rng, Comp comp = {}, Proj proj = {}) {
   auto wrng{std::ranges::subrange{std::ranges::begin(rng),
                                   std::ranges::end(rng) - 1}};
 
-  auto i{0z};
+  auto i{std::ptrdiff_t{0}};
 
-  for (; 2 * (i + 1) < std::ranges::size(wrng);) {
+  for (; 2 * (i + 1) < std::ranges::ssize(wrng);) {
     if (comp(proj(wrng[i]), proj(wrng[2 * i + 1]))) {
       auto const j = comp(proj(wrng[2 * i + 1]), proj(wrng[2 * (i + 1)]))
                          ? 2 * (i + 1)
@@ -65,7 +65,7 @@ pop_heap(Range &&rng, Comp comp = {}, Proj proj = {}) {
     }
   }
 
-  if (2 * i + 1 < std::ranges::size(wrng) &&
+  if (2 * i + 1 < std::ranges::ssize(wrng) &&
       comp(proj(wrng[i]), proj(wrng[2 * i + 1])))
     swap(wrng[i], wrng[2 * i + 1]);
 
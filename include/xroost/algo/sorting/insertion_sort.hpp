@@ -13,10 +13,21 @@ template <std::random_access_iterator I, std::sentinel_for<I> S,
           typename Comp = std::ranges::less, typename Proj = std::identity>
   requires std::sortable<I, Comp, Proj>
 constexpr void insertion_sort(I first, S last, Comp comp = {}, Proj proj = {}) {
+  if (first == last) [[unlikely]]
+    return;
+
+  // the items greater are moved up one by one rather than searched for and
+  // rotated, which is faster on the short ranges this sort is meant for
   for (auto i{first + 1}; i < last; ++i) {
-    std::rotate(std::ranges::upper_bound(std::ranges::subrange{first, i}, *i,
-                                         comp, proj),
-                i, i + 1);
+    if (!comp(proj(*i), proj(*(i - 1))))
+      continue;
+
+    auto v{std::ranges::iter_move(i)};
+    auto j{i};
+    do {
+      *j = std::ranges::iter_move(j - 1);
+    } while (--j != first && comp(proj(v), proj(*(j - 1))));
+    *j = std::move(v);
   }
 }
 
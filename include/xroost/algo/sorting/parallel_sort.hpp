@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <xroost/algo/sorting/quick_sort.hpp>
+#include <xroost/thread_pool.hpp>
+
+namespace xroost::detail {
+
+// ranges shorter than that are sorted by one thread
+inline constexpr size_t parallel_sort_cutoff{size_t{1} << 16};
+inline constexpr size_t sample_sort_max_buckets{256};
+// samples taken per bucket
+inline constexpr size_t sample_sort_oversampling{16};
+
+// the splitters of the buckets laid out as a complete binary search tree in
+// the order of a heap, so that an item is classified with log2 buckets
+// comparisons and no branch on their outcome: node j has children 2j and
+// 2j + 1, the leaves below the last level are the buckets. With equality
+// buckets, every bucket but the last one is split in two: the keys equal to
+// its splitter go to a bucket of their own, which needs no sorting
+template <typename Key, typename Comp> class sample_sort_tree {
+public:
+  // the splitters are sorted, there are buckets - 1 of them
+  sample_sort_tree(std::vector<Key> splitters, size_t buckets, bool equality,
+                   Comp &comp)
+      : buckets_(buckets), levels_(std::countr_zero(buckets)),
+        equality_(equality), comp_(comp) {
+    nodes_.reserve(buckets);
+    // node 0 is never looked at
+    nodes_.push_back(splitters.front());
+    for (size_t level = 0; level < levels_; ++level) {
+      auto const step{buckets >> level};
+      for (size_t i = 0; i < (size_t{1} << level); ++i)
+        nodes_.push_back(splitters[step * i + step / 2 - 1]);
+    }
+    if (equality_)
+      splitters_ = std::move(splitters);
+  }
+
+  size_t buckets() const noexcept {
+    return equality_ ? 2 * buckets_ : buckets_;
+  }
+
+  // whether every key of the bucket is equal to its splitter
+  bool equal(size_t bucket) const noexcept { return equality_ && bucket % 2; }
+
+  // the bucket b of a key is the one such that splitter b - 1 < key <=
+  // splitter b, it is 2b or 2b + 1 with equality buckets
+  template <typename K> size_t operator()(K const &key) const {
+    size_t j{1};
+    for (size_t level = 0; level < levels_; ++level)
+      j = 2 * j + static_cast<bool>(comp_(nodes_[j], key));
+    auto const bucket{j - buckets_};
+    if (!equality_)
+      return bucket;
+    return 2 * bucket + (bucket + 1 < buckets_ &&
+                         !static_cast<bool>(comp_(key, splitters_[bucket])));
+  }
+
+private:
+  std::vector<Key> nodes_;
+  std::vector<Key> splitters_;
+  size_t const buckets_;
+  size_t const levels_;
+  bool const equality_;
+  Comp &comp_;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::algo {
+
+// sample sort on the pool: the splitters of up to 256 buckets are picked
+// out of a random sample of the items sorted, the items are classified and
+// scattered into a buffer bucket by bucket from as many chunks of the range
+// in parallel, and the buckets are sorted by quick_sort and moved back in
+// parallel. Keys repeated among the splitters get buckets of their own that
+// are not sorted, see detail::sample_sort_tree. Ranges shorter than
+// detail::parallel_sort_cutoff are sorted by quick_sort in place, so are the
+// ranges whose items cannot be buffered without being initialized first or
+// whose keys cannot be copied
+template <std::random_access_iterator I, std::sentinel_for<I> S,
+          typename Comp = std::ranges::less, typename Proj = std::identity>
+  requires std::sortable<I, Comp, Proj>
+void parallel_sort(thread_pool &pool, I first, S last, Comp comp = {},
+                   Proj proj = {}) {
+  using value_type = std::iter_value_t<I>;
+  using key_type = std::remove_cvref_t<std::indirect_result_t<Proj &, I>>;
+
+  auto const end{std::ranges::next(first, last)};
+  auto const size{static_cast<size_t>(end - first)};
+
+  if constexpr (!(std::default_initializable<value_type> &&
+                  std::copyable<key_type>)) {
+    quick_sort(first, end, std::move(comp), std::move(proj));
+    return;
+  } else {
+    if (size < detail::parallel_sort_cutoff || pool.size() < 2) {
+      quick_sort(first, end, std::move(comp), std::move(proj));
+      return;
+    }
+
+    auto buckets{std::min(detail::sample_sort_max_buckets,
+                          std::bit_ceil(4 * pool.size()))};
+
+    std::vector<key_type> samples;
+    samples.reserve(buckets * detail::sample_sort_oversampling);
+    std::minstd_rand random;
+    std::uniform_int_distribution<size_t> position{0, size - 1};
+    for (size_t i = 0; i < buckets * detail::sample_sort_oversampling; ++i)
+      samples.push_back(std::invoke(proj, first[position(random)]));
+    quick_sort(samples, comp);
+
+    std::vector<key_type> splitters;
+    splitters.reserve(buckets - 1);
+    for (size_t i = 1; i < buckets; ++i)
+      splitters.push_back(samples[i * detail::sample_sort_oversampling - 1]);
+
+    // equal splitters would leave the buckets between them empty and the
+    // keys equal to them in one bucket to sort: the splitters are made
+    // distinct and get equality buckets instead, every other one is dropped
+    // for the buckets and the equality buckets not to outnumber buckets
+    auto const equal{
+        [&comp](auto const &a, auto const &b) { return !comp(a, b); }};
+    bool const equality{std::ranges::adjacent_find(splitters, equal) !=
+                        splitters.end()};
+    auto tree_buckets{buckets};
+    if (equality) {
+      splitters.erase(std::ranges::unique(splitters, equal).begin(),
+                      splitters.end());
+      if (2 * std::bit_ceil(splitters.size() + 1) > buckets) {
+        for (size_t i = 0; i < splitters.size() / 2; ++i)
+          splitters[i] = std::move(splitters[2 * i + 1]);
+        splitters.resize(splitters.size() / 2);
+      }
+      tree_buckets = std::bit_ceil(splitters.size() + 1);
+      auto const greatest{splitters.back()};
+      splitters.resize(tree_buckets - 1, greatest);
+    }
+
+    detail::sample_sort_tree<key_type, Comp> const classify{
+        std::move(splitters), tree_buckets, equality, comp};
+    buckets = classify.buckets();
+
+    // the items of a chunk are counted per bucket while classified, the
+    // bucket of every item is kept not to be classified twice
+    auto const chunks{std::min(4 * pool.size(), size / 1024)};
+    auto const chunk_size{(size + chunks - 1) / chunks};
+    std::vector<size_t> offsets(chunks * buckets);
+    auto const bucket_of{std::make_unique_for_overwrite<uint8_t[]>(size)};
+
+    pool.parallel_for(size_t{0}, chunks, size_t{1}, [&](size_t chunk) {
+      auto *const counts{offsets.data() + chunk * buckets};
+      auto const chunk_end{std::min(size, (chunk + 1) * chunk_size)};
+      for (auto i{chunk * chunk_size}; i < chunk_end; ++i) {
+        auto const bucket{classify(std::invoke(proj, first[i]))};
+        bucket_of[i] = static_cast<uint8_t>(bucket);
+        ++counts[bucket];
+      }
+    });
+
+    // the counts turn into the positions the chunks start filling the
+    // buckets at, a bucket is filled by the chunks in their order
+    std::vector<size_t> bucket_begins(buckets + 1);
+    for (size_t bucket = 0, offset = 0; bucket < buckets; ++bucket) {
+      bucket_begins[bucket] = offset;
+      for (size_t chunk = 0; chunk < chunks; ++chunk)
+        offset += std::exchange(offsets[chunk * buckets + bucket], offset);
+    }
+    bucket_begins[buckets] = size;
+
+    auto const buffer{std::make_unique_for_overwrite<value_type[]>(size)};
+
+    pool.parallel_for(size_t{0}, chunks, size_t{1}, [&](size_t chunk) {
+      auto *const positions{offsets.data() + chunk * buckets};
+      auto const chunk_end{std::min(size, (chunk + 1) * chunk_size)};
+      for (auto i{chunk * chunk_size}; i < chunk_end; ++i)
+        buffer[positions[bucket_of[i]]++] = std::ranges::iter_move(first + i);
+    });
+
+    pool.parallel_for(size_t{0}, buckets, size_t{1}, [&](size_t bucket) {
+      auto *const bucket_first{buffer.get() + bucket_begins[bucket]};
+      auto *const bucket_last{buffer.get() + bucket_begins[bucket + 1]};
+      if (!classify.equal(bucket))
+        quick_sort(bucket_first, bucket_last, comp, proj);
+      std::ranges::move(bucket_first, bucket_last,
+                        first + bucket_begins[bucket]);
+    });
+  }
+}
+
+template <std::ranges::random_access_range Range,
+          typename Comp = std::ranges::less, typename Proj = std::identity>
+  requires std::sortable<std::ranges::iterator_t<Range>, Comp, Proj>
+void parallel_sort(thread_pool &pool, Range &&rng, Comp comp = {},
+                   Proj proj = {}) {
+  parallel_sort(pool, std::ranges::begin(rng), std::ranges::end(rng),
+                std::move(comp), std::move(proj));
+}
+
+} // namespace xroost::algo
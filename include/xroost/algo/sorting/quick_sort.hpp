@@ -3,47 +3,127 @@
 #include <cstddef>
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <ranges>
-#include <stack>
 #include <utility>
 
 #include <xroost/algo/partition.hpp>
+#include <xroost/algo/sorting/heap_sort.hpp>
+#include <xroost/algo/sorting/insertion_sort.hpp>
+
+namespace xroost::detail {
+
+// ranges not longer than that are left to insertion sort
+inline constexpr std::ptrdiff_t quick_sort_cutoff{24};
+// ranges longer than that get the ninther for the pivot
+inline constexpr std::ptrdiff_t quick_sort_ninther{128};
+
+// sorts the three items, so that the median ends up in b
+template <std::random_access_iterator I, typename Comp, typename Proj>
+constexpr void sort3(I a, I b, I c, Comp &comp, Proj &proj) {
+  if (comp(proj(*b), proj(*a)))
+    std::iter_swap(a, b);
+  if (comp(proj(*c), proj(*b))) {
+    std::iter_swap(b, c);
+    if (comp(proj(*b), proj(*a)))
+      std::iter_swap(a, b);
+  }
+}
+
+// puts the median of 3 or, for long ranges, Tukey's ninther into the first
+// item to be the pivot
+template <std::random_access_iterator I, typename Comp, typename Proj>
+constexpr void quick_sort_pivot(I first, I last, Comp &comp, Proj &proj) {
+  auto const size{last - first};
+  auto const mid{first + size / 2};
+  if (size > quick_sort_ninther) {
+    auto const step{size / 8};
+    sort3(first + 1, first + 1 + step, first + 1 + 2 * step, comp, proj);
+    sort3(mid - step, mid, mid + step, comp, proj);
+    sort3(last - 1 - 2 * step, last - 1 - step, last - 1, comp, proj);
+    sort3(first + 1 + step, mid, last - 1 - step, comp, proj);
+  } else {
+    sort3(first + 1, mid, last - 1, comp, proj);
+  }
+  std::iter_swap(first, mid);
+}
+
+} // namespace xroost::detail
 
 namespace xroost::algo {
 
+// introsort: quick sort on the median of 3 or the ninther down to short
+// ranges left to insertion sort, heap sort for the ranges that have been
+// split unevenly too many times. A pivot not greater than the one the range
+// has been split off by, which is the item right before the range, equals it,
+// the items equal to it are then put aside at once, so that runs of equal
+// items cost a single pass. The longer part of a range split is put on a
+// work list and the shorter one is sorted first, hence the list holds no
+// more than log2 n ranges
 template <std::random_access_iterator I, std::sentinel_for<I> S,
           typename Comp = std::ranges::less, typename Proj = std::identity>
   requires std::sortable<I, Comp, Proj>
 constexpr void quick_sort(I first, S last, Comp comp = {}, Proj proj = {}) {
-  if (std::ranges::distance(first, last) < 2) [[unlikely]]
+  auto const begin{first};
+  auto const end{std::ranges::next(first, last)};
+  if (end - begin < 2) [[unlikely]]
     return;
 
-  std::stack<decltype(std::ranges::subrange{first, last})> s;
-  s.push({first, last});
-  while (!s.empty()) {
-    auto const [first, last] = s.top();
-    s.pop();
-    // the middle item swapped for the first to set the latter to be a pivot
-    // item to compare against
-    std::iter_swap(first, first + (last - first) / 2);
-    // partition the range [first + 1, last) with respect to the first item as
-    // the pivot
-    auto mid = partition(
-                   first + 1, last,
-                   [=](auto const &v) { return comp(v, proj(*first)); }, proj) -
-               1;
-    // swap the first item for the last item that in the first part of
-    // partitioned range upon this operation the range is devided into [first,
-    // mid - 1] < mid <= [mid + 1, last)
-    std::iter_swap(first, mid);
-    if (mid - first > 1) [[likely]]
-      s.push({first, mid});
-    ++mid;
-    if (last - mid > 1) [[likely]]
-      s.push({mid, last});
+  struct work {
+    I first;
+    I last;
+    // the splits left before falling back to heap sort
+    int depth;
+  };
+  std::array<work, std::numeric_limits<std::size_t>::digits> works;
+  size_t size{0};
+
+  works[size++] = {
+      begin, end,
+      2 * static_cast<int>(std::bit_width(static_cast<size_t>(end - begin)))};
+  while (0 != size) {
+    auto [lo, hi, depth] = works[--size];
+    for (;;) {
+      if (!(hi - lo > detail::quick_sort_cutoff)) {
+        insertion_sort(lo, hi, comp, proj);
+        break;
+      }
+      if (0 == depth--) [[unlikely]] {
+        heap_sort(std::ranges::subrange{lo, hi}, comp, proj);
+        break;
+      }
+
+      detail::quick_sort_pivot(lo, hi, comp, proj);
+      auto const &pivot{proj(*lo)};
+
+      if (lo != begin && !comp(proj(*(lo - 1)), pivot)) {
+        // the items equal to the pivot go first and are done with
+        lo = partition(
+            lo + 1, hi,
+            [&](auto const &v) { return !comp(pivot, v); }, proj);
+        continue;
+      }
+
+      // [lo, mid) < mid <= [mid + 1, hi)
+      auto const mid{partition(
+                         lo + 1, hi,
+                         [&](auto const &v) { return comp(v, pivot); }, proj) -
+                     1};
+      std::iter_swap(lo, mid);
+
+      if (mid - lo < hi - (mid + 1)) {
+        works[size++] = {mid + 1, hi, depth};
+        hi = mid;
+      } else {
+        works[size++] = {lo, mid, depth};
+        lo = mid + 1;
+      }
+    }
   }
 }
 
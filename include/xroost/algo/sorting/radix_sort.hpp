@@ -0,0 +1,237 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <xroost/algo/sorting/quick_sort.hpp>
+
+namespace xroost::algo {
+
+// fixed-width integers and IEEE floats of 32 and 64 bits
+template <typename T>
+concept radix_key =
+    (std::integral<T> && !std::same_as<T, bool>) ||
+    (std::floating_point<T> && std::numeric_limits<T>::is_iec559 &&
+     (sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t)));
+
+} // namespace xroost::algo
+
+namespace xroost::detail {
+
+// the key turned into an unsigned integer of the same width ordered the
+// same way: the sign bit of a signed integer is flipped, so is the sign bit
+// of a positive float, while every bit of a negative one is flipped, which
+// puts -0.0 before 0.0 and NaNs at either end depending on their sign
+template <algo::radix_key T> constexpr auto radix_bits(T key) noexcept {
+  if constexpr (std::floating_point<T>) {
+    using U = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t,
+                                 uint64_t>;
+    constexpr U sign{U{1} << (sizeof(U) * CHAR_BIT - 1)};
+    auto const bits{std::bit_cast<U>(key)};
+    return static_cast<U>(bits & sign ? ~bits : bits | sign);
+  } else {
+    using U = std::make_unsigned_t<T>;
+    if constexpr (std::signed_integral<T>) {
+      constexpr U sign{static_cast<U>(U{1} << (sizeof(U) * CHAR_BIT - 1))};
+      return static_cast<U>(static_cast<U>(key) ^ sign);
+    } else {
+      return static_cast<U>(key);
+    }
+  }
+}
+
+template <typename I, typename Proj>
+using radix_key_t = std::remove_cvref_t<std::indirect_result_t<Proj &, I>>;
+
+// buckets not longer than that are left to quick_sort by msd_radix_sort
+inline constexpr size_t msd_radix_sort_cutoff{64};
+
+// sorts [first, last) by the bits of the keys from the digit at shift down,
+// the keys are equal in the bits above
+template <std::random_access_iterator I, typename Key>
+void msd_radix_sort(I first, I last, Key &key, int shift) {
+  constexpr size_t radix{256};
+
+  for (;;) {
+    auto const size{static_cast<size_t>(last - first)};
+    if (!(size > msd_radix_sort_cutoff)) {
+      algo::quick_sort(first, last, std::ranges::less{}, key);
+      return;
+    }
+
+    auto const digit_of{[&key, shift](auto const &v) {
+      return static_cast<size_t>(key(v) >> shift & (radix - 1));
+    }};
+
+    std::array<size_t, radix> counts{};
+    for (auto it{first}; it != last; ++it)
+      ++counts[digit_of(*it)];
+
+    // the keys sharing the digit are not moved
+    if (std::ranges::find(counts, size) == counts.end()) {
+      // american flag: every item is swapped into the next free place of its
+      // bucket until the bucket of the item in place is its own
+      std::array<size_t, radix> heads, tails;
+      for (size_t bucket = 0, offset = 0; bucket < radix; ++bucket) {
+        heads[bucket] = offset;
+        offset += counts[bucket];
+        tails[bucket] = offset;
+      }
+
+      for (size_t bucket = 0; bucket < radix; ++bucket) {
+        while (heads[bucket] < tails[bucket]) {
+          auto const digit{digit_of(first[heads[bucket]])};
+          if (digit == bucket)
+            ++heads[bucket];
+          else
+            std::iter_swap(first + heads[bucket], first + heads[digit]++);
+        }
+      }
+
+      if (0 == shift)
+        return;
+
+      for (size_t bucket = 0, offset = 0; bucket < radix; ++bucket) {
+        if (counts[bucket] > 1) {
+          msd_radix_sort(first + offset, first + offset + counts[bucket], key,
+                         shift - CHAR_BIT);
+        }
+        offset += counts[bucket];
+      }
+      return;
+    }
+
+    if (0 == shift)
+      return;
+    shift -= CHAR_BIT;
+  }
+}
+
+} // namespace xroost::detail
+
+namespace xroost::algo {
+
+// in place MSD radix sort by the projected keys ascending, American flag
+// sort: the items are counted by the highest byte of the keys and swapped
+// into their buckets, every bucket is then sorted the same way by the next
+// byte; the bytes all the keys share are skipped and the buckets not longer
+// than detail::msd_radix_sort_cutoff are left to quick_sort. It is not
+// stable and needs no memory but the counters of the bytes being sorted by
+template <std::random_access_iterator I, std::sentinel_for<I> S,
+          typename Proj = std::identity>
+  requires(std::permutable<I> && radix_key<detail::radix_key_t<I, Proj>>)
+void msd_radix_sort(I first, S last, Proj proj = {}) {
+  auto key{[&proj](auto const &v) {
+    return detail::radix_bits(std::invoke(proj, v));
+  }};
+  using bits_type = decltype(key(*first));
+
+  detail::msd_radix_sort(first, std::ranges::next(first, last), key,
+                         static_cast<int>(sizeof(bits_type) - 1) * CHAR_BIT);
+}
+
+template <std::ranges::random_access_range Range,
+          typename Proj = std::identity>
+  requires(std::permutable<std::ranges::iterator_t<Range>> &&
+           radix_key<
+               detail::radix_key_t<std::ranges::iterator_t<Range>, Proj>>)
+void msd_radix_sort(Range &&rng, Proj proj = {}) {
+  msd_radix_sort(std::ranges::begin(rng), std::ranges::end(rng),
+                 std::move(proj));
+}
+
+// LSD radix sort by the projected keys ascending: one pass over the items
+// counts the digits of DigitBits bits of every key, then the items are
+// scattered into a buffer and back digit by digit from the lowest one; the
+// digits that all the keys share are skipped. It is stable, takes a buffer
+// of as many items and at most 2^DigitBits counters per digit. Items that
+// cannot be buffered without being initialized first are sorted by
+// msd_radix_sort
+template <size_t DigitBits = 8, std::random_access_iterator I,
+          std::sentinel_for<I> S, typename Proj = std::identity>
+  requires(std::permutable<I> && radix_key<detail::radix_key_t<I, Proj>> &&
+           (8 == DigitBits || 11 == DigitBits || 16 == DigitBits))
+void lsd_radix_sort(I first, S last, Proj proj = {}) {
+  using value_type = std::iter_value_t<I>;
+  auto const end{std::ranges::next(first, last)};
+
+  if constexpr (!std::default_initializable<value_type>) {
+    msd_radix_sort(first, end, std::move(proj));
+    return;
+  } else {
+    auto const size{static_cast<size_t>(end - first)};
+    if (size < 2) [[unlikely]]
+      return;
+
+    auto const key{[&proj](auto const &v) {
+      return detail::radix_bits(std::invoke(proj, v));
+    }};
+    using bits_type = decltype(key(*first));
+
+    constexpr size_t radix{size_t{1} << DigitBits};
+    constexpr size_t digits{
+        (sizeof(bits_type) * CHAR_BIT + DigitBits - 1) / DigitBits};
+
+    std::vector<size_t> counts(digits * radix);
+    for (auto it{first}; it != end; ++it) {
+      auto const bits{key(*it)};
+      for (size_t digit = 0; digit < digits; ++digit)
+        ++counts[digit * radix + (bits >> (digit * DigitBits) & (radix - 1))];
+    }
+
+    auto const buffer{std::make_unique_for_overwrite<value_type[]>(size)};
+    // the items are in the buffer after an odd number of passes
+    bool buffered{false};
+
+    for (size_t digit = 0; digit < digits; ++digit) {
+      auto *const offsets{counts.data() + digit * radix};
+      if (std::find(offsets, offsets + radix, size) != offsets + radix)
+        continue;
+
+      for (size_t bucket = 0, offset = 0; bucket < radix; ++bucket)
+        offset += std::exchange(offsets[bucket], offset);
+
+      auto const scatter{[&](auto from, auto to) {
+        for (size_t i = 0; i < size; ++i) {
+          auto const bucket{key(from[i]) >> (digit * DigitBits) & (radix - 1)};
+          to[offsets[bucket]++] = std::ranges::iter_move(from + i);
+        }
+      }};
+      if (buffered)
+        scatter(buffer.get(), first);
+      else
+        scatter(first, buffer.get());
+      buffered = !buffered;
+    }
+
+    if (buffered)
+      std::ranges::move(buffer.get(), buffer.get() + size, first);
+  }
+}
+
+template <size_t DigitBits = 8, std::ranges::random_access_range Range,
+          typename Proj = std::identity>
+  requires(std::permutable<std::ranges::iterator_t<Range>> &&
+           radix_key<detail::radix_key_t<std::ranges::iterator_t<Range>,
+                                         Proj>> &&
+           (8 == DigitBits || 11 == DigitBits || 16 == DigitBits))
+void lsd_radix_sort(Range &&rng, Proj proj = {}) {
+  lsd_radix_sort<DigitBits>(std::ranges::begin(rng), std::ranges::end(rng),
+                            std::move(proj));
+}
+
+} // namespace xroost::algo
@@ -4,6 +4,8 @@
 #include "counting_sort.hpp"
 #include "heap_sort.hpp"
 #include "insertion_sort.hpp"
+#include "parallel_sort.hpp"
 #include "quick_sort.hpp"
 #include "quick_sort_r.hpp"
+#include "radix_sort.hpp"
 #include "selection_sort.hpp"
@@ -47,6 +47,8 @@ private:
     size_t height() const { return height_; }
 
   private:
+    friend class avl_tree;
+
     value_type value_;
     size_t height_{1};
     memory::unique_ptr<node, std::function<void(struct node *)>> p_left_,
@@ -163,6 +165,7 @@ private:
 
 public:
   avl_tree() = default;
+  explicit avl_tree(allocator_type const &allocator) : allocator_(allocator) {}
   ~avl_tree() = default;
 
   enum class printer { prefix, infix, postfix };
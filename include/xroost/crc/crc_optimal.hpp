@@ -3,9 +3,19 @@
 #include <climits>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
-#include <numeric>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
 
+#include <xroost/crc/hardware.hpp>
+#include <xroost/endian/endian.hpp>
 #include <xroost/integer.hpp>
 
 namespace xroost::crc {
@@ -15,7 +25,7 @@ constexpr auto reflect_(ValueType v) {
   using ReflectedType = typename uint_t<Bits>::fast;
 
   ReflectedType result = 0;
-  for (auto i = 0; i < Bits; ++i) {
+  for (size_t i = 0; i < Bits; ++i) {
     if (v & (static_cast<ReflectedType>(0x1) << i)) {
       result |= (static_cast<ReflectedType>(0x1) << (Bits - 1 - i));
     }
@@ -23,7 +33,11 @@ constexpr auto reflect_(ValueType v) {
   return result;
 }
 
-template <size_t Bits, typename uint_t<Bits>::fast Poly, bool Reflected>
+// Slices tables: table k holds the CRC of a byte followed by k zero bytes, so
+// that a slicing-by-Slices update consumes Slices bytes per iteration; the
+// reflected register is kept in the low Bits bits
+template <size_t Bits, typename uint_t<Bits>::fast Poly, bool Reflected,
+          size_t Slices = 1>
 class CRCTable {
 public:
   static constexpr auto kCRCTableSize = 256;
@@ -36,43 +50,87 @@ public:
         table_value = table_value & 0x1
                           ? (table_value >> 1) ^ reflect_<Bits>(Poly)
                           : (table_value >> 1);
-      table[i] = table_value;
+      table[0][i] = table_value;
+    }
+    for (size_t k = 1; k < Slices; ++k) {
+      for (auto i = 0; i < kCRCTableSize; ++i)
+        table[k][i] = shift(table[k - 1][i]);
     }
   }
 
   template <typename PosType>
   constexpr auto operator[](PosType pos) const noexcept {
-    return table[pos];
+    return table[0][pos];
+  }
+
+  template <typename PosType>
+  constexpr auto operator()(size_t slice, PosType pos) const noexcept {
+    return table[slice][pos];
+  }
+
+  // the register after the byte
+  constexpr CRCType update(CRCType crc, uint8_t byte) const noexcept {
+    return table[0][(crc ^ byte) & 0xFF] ^ (crc >> CHAR_BIT);
+  }
+
+  // the register after a zero byte
+  constexpr CRCType shift(CRCType crc) const noexcept {
+    return update(crc, 0);
   }
 
 private:
-  CRCType table[kCRCTableSize];
+  CRCType table[Slices][kCRCTableSize];
 };
 
-template <size_t Bits, typename uint_t<Bits>::fast Poly>
-struct CRCTable<Bits, Poly, false> {
+// the register is kept in the high Bits bits of CRCType, so that a byte is
+// always taken in from its top byte whatever Bits is
+template <size_t Bits, typename uint_t<Bits>::fast Poly, size_t Slices>
+struct CRCTable<Bits, Poly, false, Slices> {
 public:
   static constexpr auto kCRCTableSize = 256;
   using CRCType = typename uint_t<Bits>::fast;
 
-  CRCTable() {
+  static constexpr size_t kRegisterShift = sizeof(CRCType) * CHAR_BIT - Bits;
+
+  constexpr CRCTable() {
+    constexpr auto kTopShift = sizeof(CRCType) * CHAR_BIT - 1;
+    constexpr CRCType kPoly = Poly << kRegisterShift;
     for (auto i = 0; i < kCRCTableSize; ++i) {
-      CRCType table_value = i;
+      CRCType table_value = static_cast<CRCType>(i) << (kTopShift - 7);
       for (auto k = 0; k < 8; ++k)
-        table_value = table_value & (0x1 << (Bits - 1))
-                          ? (table_value << 1) ^ Poly
-                          : (table_value << 1);
-      table[i] = table_value;
+        table_value = table_value >> kTopShift
+                          ? static_cast<CRCType>(table_value << 1) ^ kPoly
+                          : static_cast<CRCType>(table_value << 1);
+      table[0][i] = table_value;
+    }
+    for (size_t k = 1; k < Slices; ++k) {
+      for (auto i = 0; i < kCRCTableSize; ++i)
+        table[k][i] = shift(table[k - 1][i]);
     }
   }
 
   template <typename PosType>
   constexpr auto operator[](PosType pos) const noexcept {
-    return table[pos];
+    return table[0][pos];
+  }
+
+  template <typename PosType>
+  constexpr auto operator()(size_t slice, PosType pos) const noexcept {
+    return table[slice][pos];
+  }
+
+  constexpr CRCType update(CRCType crc, uint8_t byte) const noexcept {
+    constexpr auto kTopByteShift = (sizeof(CRCType) - 1) * CHAR_BIT;
+    return static_cast<CRCType>(crc << CHAR_BIT) ^
+           table[0][((crc >> kTopByteShift) ^ byte) & 0xFF];
+  }
+
+  constexpr CRCType shift(CRCType crc) const noexcept {
+    return update(crc, 0);
   }
 
 private:
-  CRCType table[kCRCTableSize];
+  CRCType table[Slices][kCRCTableSize];
 };
 
 template <bool ref_in> struct reflector {
@@ -89,46 +147,335 @@ template <> struct reflector<false> {
   }
 };
 
+// Slices is the number of bytes consumed per table-driven iteration: 1, 8 or
+// 16; the checksum does not depend on it. The tables are computed at compile
+// time and the checksum of data given as bytes is a constant expression
 template <size_t Bits, typename uint_t<Bits>::fast Poly,
           typename uint_t<Bits>::fast Init, typename uint_t<Bits>::fast XorV,
-          bool ref_in, bool ref_out>
+          bool ref_in, bool ref_out, size_t Slices = 8>
+  requires(1 == Slices || 8 == Slices || 16 == Slices)
 class crc_optimal {
 public:
   using CRCType = typename uint_t<Bits>::fast;
-  using CRCTable_ = CRCTable<Bits, Poly, ref_in>;
+  using CRCTable_ = CRCTable<Bits, Poly, ref_in, Slices>;
 
-  constexpr void operator()(void const *data, size_t size) {
-    crc_ = std::accumulate(reinterpret_cast<uint8_t const *>(data),
-                           reinterpret_cast<uint8_t const *>(data) + size, crc_,
-                           [](auto crc, auto byte) {
-                             crc ^= byte;
-                             return table_[crc & 0xFF] ^ (crc >> CHAR_BIT);
-                           });
+  // reflected CRCs go through the CPU's CRC-32C instruction or carry-less
+  // multiplication when it has them
+  void operator()(void const *data, size_t size) {
+    crc_ = update_data(crc_, static_cast<uint8_t const *>(data), size);
   }
 
-  CRCType checksum() const noexcept {
-    return out_refl_.template convert<Bits>(crc_) ^ XorV;
+  template <typename Byte>
+    requires(1 == sizeof(Byte) &&
+             (std::integral<Byte> || std::same_as<Byte, std::byte>))
+  constexpr void operator()(Byte const *data, size_t size) {
+    if (std::is_constant_evaluated()) {
+      for (size_t i = 0; i < size; ++i)
+        crc_ = table_.update(crc_, static_cast<uint8_t>(data[i]));
+    } else {
+      (*this)(static_cast<void const *>(data), size);
+    }
+  }
+
+  constexpr CRCType checksum() const noexcept { return checksum_of(crc_); }
+
+  // the checksum of the data made of a part of checksum crc_a followed by a
+  // part of len_b bytes of checksum crc_b
+  static CRCType combine(CRCType crc_a, CRCType crc_b,
+                         uint64_t len_b) noexcept {
+    // the register after a and b from the initial value is the register
+    // after a shifted over len_b zero bytes, plus the register after b
+    // from zero
+    return checksum_of(zeros(register_of(crc_a) ^ kInit, len_b) ^
+                       register_of(crc_b));
+  }
+
+  // the checksums of independent buffers, each a contiguous range of bytes,
+  // into out; buffers of about the same size are taken kLanes at a time and
+  // their updates interleaved as long as the shortest one lasts, so that the
+  // CPU overlaps their dependency chains. The buffers are sorted by their
+  // size classes kLaneChunk at a time, kLanes of them in a row go in lanes
+  // when within 1/8 of each other and one at a time otherwise. Those too
+  // short to be worth a lane are checksummed on their own, so are those the
+  // CPU goes through faster on their own
+  template <std::ranges::random_access_range Buffers>
+    requires(std::ranges::contiguous_range<
+                 std::ranges::range_reference_t<Buffers const>> &&
+             1 == sizeof(std::ranges::range_value_t<
+                         std::ranges::range_reference_t<Buffers const>>))
+  static void checksums(Buffers const &buffers, std::span<CRCType> out) {
+    auto const count{static_cast<size_t>(std::ranges::size(buffers))};
+    auto const data_of{[&buffers](size_t i) {
+      return reinterpret_cast<uint8_t const *>(
+          std::ranges::data(buffers[i]));
+    }};
+    auto const size_of{[&buffers](size_t i) {
+      return static_cast<size_t>(std::ranges::size(buffers[i]));
+    }};
+
+    auto const checksum_one{[&](size_t i) {
+      out[i] = checksum_of(update_data(kInit, data_of(i), size_of(i)));
+    }};
+
+    using lane_buffers = std::array<size_t, kLanes>;
+    // the sizes are within 1/8 of each other
+    auto const balanced{[&size_of](lane_buffers const &indices) {
+      auto shortest{size_of(indices[0])}, longest{shortest};
+      for (size_t lane = 1; lane < kLanes; ++lane) {
+        shortest = std::min(shortest, size_of(indices[lane]));
+        longest = std::max(longest, size_of(indices[lane]));
+      }
+      return !(longest - shortest > shortest / 8);
+    }};
+    auto const checksum_lanes{[&](lane_buffers const &indices) {
+      detail::crc_lanes<kLanes> lanes;
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+        lanes.ps[lane] = data_of(indices[lane]);
+        lanes.sizes[lane] = size_of(indices[lane]);
+        lanes.crcs[lane] = kInit;
+      }
+      update_lanes(lanes);
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+        out[indices[lane]] =
+            checksum_of(static_cast<CRCType>(lanes.crcs[lane]));
+      }
+    }};
+
+    size_t min_size{kLaneMinSize}, max_size{SIZE_MAX};
+    if constexpr (ref_in) {
+      min_size = std::max(min_size, detail::crc_lanes_min_size<Bits, Poly>());
+      max_size = detail::crc_lanes_max_size<Bits, Poly>();
+    }
+
+    for (size_t chunk = 0; chunk < count; chunk += kLaneChunk) {
+      auto const chunk_size{std::min(count - chunk, kLaneChunk)};
+      // the buffers of the chunk not worth a lane are checksummed right away,
+      // the others are put aside
+      std::array<uint8_t, kLaneChunk> laned, class_of, order;
+      size_t laned_size{0};
+      for (size_t j = 0; j < chunk_size; ++j) {
+        auto const size{size_of(chunk + j)};
+        if (size < min_size || size > max_size)
+          checksum_one(chunk + j);
+        else
+          laned[laned_size++] = static_cast<uint8_t>(j);
+      }
+      if (0 == laned_size)
+        continue;
+
+      // and sorted by their classes without branching on their sizes
+      std::array<uint16_t, kLaneClasses + 1> begins{};
+      for (size_t j = 0; j < laned_size; ++j) {
+        class_of[j] =
+            static_cast<uint8_t>(lane_class(size_of(chunk + laned[j])));
+        ++begins[class_of[j] + 1];
+      }
+      for (size_t k = 1; k < begins.size(); ++k)
+        begins[k] = static_cast<uint16_t>(begins[k] + begins[k - 1]);
+      for (size_t j = 0; j < laned_size; ++j)
+        order[begins[class_of[j]]++] = laned[j];
+
+      // kLanes buffers in a row go in lanes when of about the same size,
+      // otherwise the first of them is checksummed on its own
+      size_t j{0};
+      for (; !(laned_size - j < kLanes); ++j) {
+        lane_buffers indices;
+        for (size_t lane = 0; lane < kLanes; ++lane)
+          indices[lane] = chunk + order[j + lane];
+        if (balanced(indices)) {
+          checksum_lanes(indices);
+          j += kLanes - 1;
+        } else {
+          checksum_one(indices[0]);
+        }
+      }
+      for (; j < laned_size; ++j)
+        checksum_one(chunk + order[j]);
+    }
   }
 
 private:
-  CRCType crc_ = reflect_<Bits>(Init);
-  static const CRCTable_ table_;
-  static const reflector<ref_in != ref_out> out_refl_;
-};
+  static constexpr size_t kRegisterBits = sizeof(CRCType) * CHAR_BIT;
+  // a register that is not reflected is kept in the high bits
+  static constexpr size_t kRegisterShift = ref_in ? 0 : kRegisterBits - Bits;
+  static constexpr CRCType kInit =
+      ref_in ? reflect_<Bits>(Init)
+             : static_cast<CRCType>(Init << kRegisterShift);
 
-template <size_t Bits, typename uint_t<Bits>::fast Poly,
-          typename uint_t<Bits>::fast Init, typename uint_t<Bits>::fast XorV,
-          bool ref_in, bool ref_out>
-typename crc_optimal<Bits, Poly, Init, XorV, ref_in, ref_out>::CRCTable_ const
-    crc_optimal<Bits, Poly, Init, XorV, ref_in, ref_out>::table_ =
-        typename crc_optimal<Bits, Poly, Init, XorV, ref_in,
-                             ref_out>::CRCTable_();
+  using ZerosMatrix = std::array<CRCType, kRegisterBits>;
 
-template <size_t Bits, typename uint_t<Bits>::fast Poly,
-          typename uint_t<Bits>::fast Init, typename uint_t<Bits>::fast XorV,
-          bool ref_in, bool ref_out>
-reflector<ref_in != ref_out> const
-    crc_optimal<Bits, Poly, Init, XorV, ref_in, ref_out>::out_refl_ =
-        reflector<ref_in != ref_out>();
+  static constexpr CRCType checksum_of(CRCType crc) noexcept {
+    return out_refl_.template convert<Bits>(
+               static_cast<CRCType>(crc >> kRegisterShift)) ^
+           XorV;
+  }
+
+  static constexpr CRCType register_of(CRCType checksum) noexcept {
+    return static_cast<CRCType>(
+        out_refl_.template convert<Bits>(
+            static_cast<CRCType>(checksum ^ XorV))
+        << kRegisterShift);
+  }
+
+  static constexpr size_t kLanes = 4;
+  static constexpr size_t kLaneMinSize = 64;
+  // the buffers of a chunk are indexed by bytes
+  static constexpr size_t kLaneChunk = 256;
+  // sizes past 4 GiB share the last class
+  static constexpr size_t kLaneMaxWidth = 32;
+  static constexpr size_t kLaneClasses =
+      (kLaneMaxWidth + 1 - std::bit_width(kLaneMinSize)) * 8;
+
+  // the sizes of a class are within 1/8 of each other: a class is the bit
+  // width of a size and the three bits below its top one
+  static constexpr size_t lane_class(size_t size) noexcept {
+    auto const clamped{std::min(uint64_t{size}, uint64_t{UINT32_MAX})};
+    auto const width{static_cast<size_t>(std::bit_width(clamped))};
+    return (width - std::bit_width(kLaneMinSize)) * 8 +
+           static_cast<size_t>(clamped >> (width - 4) & 7);
+  }
+
+  // goes through the lanes Slices bytes at a time as long as the shortest
+  // one lasts, the rest of each is then updated on its own
+  static void update_lanes(detail::crc_lanes<kLanes> &lanes) {
+    if constexpr (ref_in) {
+      // the tables are called directly for the lanes to be finished side
+      // by side
+      if (detail::crc_update_lanes_accelerated<Bits, Poly>(
+              lanes, [](CRCType crc, uint8_t const *p, size_t size) {
+                return update(crc, p, size);
+              }))
+        return;
+    }
+
+    // the lanes are spelt out for their registers to be kept in registers
+    auto const steps{std::ranges::min(lanes.sizes) / Slices};
+    [&]<size_t... Lane>(std::index_sequence<Lane...>) {
+      CRCType crcs[]{static_cast<CRCType>(lanes.crcs[Lane])...};
+      uint8_t const *const ps[]{lanes.ps[Lane]...};
+      for (size_t i = 0; i < steps; ++i) {
+        if constexpr (Slices > 1)
+          ((crcs[Lane] = update_slices(crcs[Lane], ps[Lane] + i * Slices)),
+           ...);
+        else
+          ((crcs[Lane] = table_.update(crcs[Lane], ps[Lane][i])), ...);
+      }
+      ((lanes.crcs[Lane] = crcs[Lane]), ...);
+    }(std::make_index_sequence<kLanes>{});
+
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+      lanes.crcs[lane] = update(static_cast<CRCType>(lanes.crcs[lane]),
+                                lanes.ps[lane] + steps * Slices,
+                                lanes.sizes[lane] - steps * Slices);
+    }
+  }
+
+  // the update is linear in the register, the column i of a matrix holds
+  // the image of the bit i
+  static CRCType times(ZerosMatrix const &m, CRCType v) noexcept {
+    CRCType result = 0;
+    for (size_t i = 0; v; v >>= 1, ++i) {
+      if (v & 1)
+        result ^= m[i];
+    }
+    return result;
+  }
+
+  // the matrices of the update with 2^k zero bytes
+  static std::array<ZerosMatrix, 64> const &zeros_powers() {
+    static auto const powers{[] {
+      std::array<ZerosMatrix, 64> powers;
+      for (size_t i = 0; i < kRegisterBits; ++i)
+        powers[0][i] = table_.shift(static_cast<CRCType>(CRCType{1} << i));
+      for (size_t k = 1; k < powers.size(); ++k) {
+        for (size_t i = 0; i < kRegisterBits; ++i)
+          powers[k][i] = times(powers[k - 1], powers[k - 1][i]);
+      }
+      return powers;
+    }()};
+    return powers;
+  }
+
+  // the register after n zero bytes more
+  static CRCType zeros(CRCType crc, uint64_t n) noexcept {
+    auto const &powers{zeros_powers()};
+    for (size_t k = 0; n; n >>= 1, ++k) {
+      if (n & 1)
+        crc = times(powers[k], crc);
+    }
+    return crc;
+  }
+
+  // the register after the data, through the CPU when it allows
+  static CRCType update_data(CRCType crc, uint8_t const *p,
+                             size_t size) noexcept {
+    if constexpr (ref_in) {
+      uint64_t wide_crc{crc};
+      if (detail::crc_update_accelerated<Bits, Poly>(wide_crc, p, size,
+                                                     update))
+        return static_cast<CRCType>(wide_crc);
+    }
+    return update(crc, p, size);
+  }
+
+  static CRCType update(CRCType crc, uint8_t const *p, size_t size) noexcept {
+    if constexpr (Slices > 1) {
+      for (; !(size < Slices); size -= Slices, p += Slices)
+        crc = update_slices(crc, p);
+    }
+
+    for (; size; --size, ++p)
+      crc = table_.update(crc, *p);
+
+    return crc;
+  }
+
+  // a reflected CRC takes a word in from its lowest byte, the other ones from
+  // the highest
+  static uint64_t load_word(uint8_t const *p) noexcept {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if constexpr (ref_in)
+      return endian::little_to_native(word);
+    else
+      return endian::big_to_native(word);
+  }
+
+  static constexpr uint64_t word_of(CRCType crc) noexcept {
+    if constexpr (ref_in)
+      return crc;
+    else
+      return uint64_t{crc} << (64 - kRegisterBits);
+  }
+
+  template <size_t J>
+  static constexpr uint8_t byte_of(uint64_t word) noexcept {
+    if constexpr (ref_in)
+      return word >> J * CHAR_BIT & 0xFF;
+    else
+      return word >> (sizeof(uint64_t) - 1 - J) * CHAR_BIT & 0xFF;
+  }
+
+  // every byte goes through the table of the number of bytes that follow
+  // it, the CRC itself is added to the first word
+  static CRCType update_slices(CRCType crc, uint8_t const *p) noexcept {
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+      return (... ^ update_word<I>(p, 0 == I ? crc : CRCType{0}));
+    }(std::make_index_sequence<Slices / sizeof(uint64_t)>{});
+  }
+
+  template <size_t I>
+  static CRCType update_word(uint8_t const *p, CRCType crc) noexcept {
+    auto const word{load_word(p + I * sizeof(uint64_t)) ^ word_of(crc)};
+    return [word]<size_t... J>(std::index_sequence<J...>) {
+      return (... ^ table_(Slices - 1 - I * sizeof(uint64_t) - J,
+                           byte_of<J>(word)));
+    }(std::make_index_sequence<sizeof(uint64_t)>{});
+  }
+
+  CRCType crc_ = kInit;
+  static constexpr CRCTable_ table_{};
+  static constexpr reflector<ref_in != ref_out> out_refl_{};
+};
 
 } // namespace xroost::crc
@@ -0,0 +1,497 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
+namespace xroost::detail {
+
+// arithmetic on the polynomials modulo x^Bits + Poly in the normal order,
+// the coefficient of x^i being the bit i
+
+template <size_t Bits> constexpr uint64_t crc_mask() noexcept {
+  return Bits < 64 ? (uint64_t{1} << Bits) - 1 : ~uint64_t{0};
+}
+
+template <size_t Bits> constexpr uint64_t crc_reflect(uint64_t v) noexcept {
+  uint64_t result{0};
+  for (size_t i = 0; i < Bits; ++i)
+    result |= (v >> i & 1) << (Bits - 1 - i);
+  return result;
+}
+
+template <size_t Bits>
+constexpr uint64_t crc_mulx(uint64_t a, uint64_t poly) noexcept {
+  auto const carry{a >> (Bits - 1) & 1};
+  a = a << 1 & crc_mask<Bits>();
+  return carry ? a ^ poly : a;
+}
+
+template <size_t Bits>
+constexpr uint64_t crc_multiply(uint64_t a, uint64_t b,
+                                uint64_t poly) noexcept {
+  uint64_t result{0};
+  for (size_t i = Bits; i-- > 0;) {
+    result = crc_mulx<Bits>(result, poly);
+    if (a >> i & 1)
+      result ^= b;
+  }
+  return result;
+}
+
+// x^n
+template <size_t Bits>
+constexpr uint64_t crc_xpow(uint64_t n, uint64_t poly) noexcept {
+  uint64_t result{1}, square{crc_mulx<Bits>(1, poly)};
+  for (; n; n >>= 1) {
+    if (n & 1)
+      result = crc_multiply<Bits>(result, square, poly);
+    square = crc_multiply<Bits>(square, square, poly);
+  }
+  return result;
+}
+
+inline uint64_t crc_load_word(uint8_t const *p) noexcept {
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// independent buffers checksummed at once, one per lane: the data of each
+// lane, its size and its register so far
+template <size_t Lanes> struct crc_lanes {
+  std::array<uint8_t const *, Lanes> ps;
+  std::array<size_t, Lanes> sizes;
+  std::array<uint64_t, Lanes> crcs;
+};
+
+} // namespace xroost::detail
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+namespace xroost::detail {
+
+struct crc_cpu_features {
+  bool crc32c;
+  bool clmul;
+  bool wide_clmul;
+};
+
+inline crc_cpu_features const &crc_cpu() noexcept {
+  static crc_cpu_features const features{[] {
+    __builtin_cpu_init();
+    auto const clmul{__builtin_cpu_supports("pclmul") &&
+                     __builtin_cpu_supports("sse4.1")};
+    return crc_cpu_features{
+        .crc32c = 0 != __builtin_cpu_supports("sse4.2"),
+        .clmul = clmul,
+        .wide_clmul = clmul && __builtin_cpu_supports("avx2") &&
+                      __builtin_cpu_supports("vpclmulqdq"),
+    };
+  }()};
+  return features;
+}
+
+// the reflected CRC-32C register after Bytes zero bytes more
+template <size_t Bytes> class crc32c_zeros {
+public:
+  constexpr crc32c_zeros() {
+    auto const shift{crc_xpow<32>(Bytes * 8, poly)};
+    for (size_t k = 0; k < 4; ++k) {
+      for (uint64_t i = 0; i < 256; ++i) {
+        auto const crc{crc_reflect<32>(i << k * 8)};
+        table_[k][i] = static_cast<uint32_t>(
+            crc_reflect<32>(crc_multiply<32>(crc, shift, poly)));
+      }
+    }
+  }
+
+  constexpr uint32_t operator()(uint32_t crc) const noexcept {
+    return table_[0][crc & 0xFF] ^ table_[1][crc >> 8 & 0xFF] ^
+           table_[2][crc >> 16 & 0xFF] ^ table_[3][crc >> 24];
+  }
+
+private:
+  static constexpr uint64_t poly{0x1EDC6F41};
+
+  uint32_t table_[4][256];
+};
+
+template <size_t Bytes>
+inline constexpr crc32c_zeros<Bytes> crc32c_zeros_v{};
+
+// the crc32 instruction has a latency of 3 cycles and a throughput of 1, so
+// the data goes in three streams of Bytes each, the CRCs of the first two
+// are then shifted over the ones following them
+template <size_t Bytes>
+[[gnu::target("sse4.2")]] inline uint64_t
+crc32c_streams(uint64_t crc, uint8_t const *&p, size_t &size) noexcept {
+  for (; !(size < 3 * Bytes); size -= 3 * Bytes) {
+    uint64_t crc1{0}, crc2{0};
+    for (auto const *const end{p + Bytes}; p != end; p += sizeof(uint64_t)) {
+      uint64_t words[3];
+      std::memcpy(&words[0], p, sizeof(uint64_t));
+      std::memcpy(&words[1], p + Bytes, sizeof(uint64_t));
+      std::memcpy(&words[2], p + 2 * Bytes, sizeof(uint64_t));
+      crc = _mm_crc32_u64(crc, words[0]);
+      crc1 = _mm_crc32_u64(crc1, words[1]);
+      crc2 = _mm_crc32_u64(crc2, words[2]);
+    }
+    crc = crc32c_zeros_v<Bytes>(crc) ^ crc1;
+    crc = crc32c_zeros_v<Bytes>(crc) ^ crc2;
+    p += 2 * Bytes;
+  }
+  return crc;
+}
+
+// the reflected CRC-32C register after the data
+[[gnu::target("sse4.2")]] inline uint64_t
+crc32c_update(uint64_t crc, uint8_t const *p, size_t size) noexcept {
+  crc = crc32c_streams<8192>(crc, p, size);
+  crc = crc32c_streams<256>(crc, p, size);
+
+  for (; !(size < sizeof(uint64_t));
+       size -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    crc = _mm_crc32_u64(crc, word);
+  }
+  for (; size; --size, ++p)
+    crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *p);
+
+  return crc;
+}
+
+// the lanes are spelt out for their registers to be kept in registers, the
+// bytes past the last word go by 4, 2 and 1 of them in turn as well
+template <size_t... Lane>
+[[gnu::target("sse4.2")]] inline void
+crc32c_words(std::array<uint64_t, sizeof...(Lane)> &crcs,
+             std::array<uint8_t const *, sizeof...(Lane)> const &ps,
+             size_t size, std::index_sequence<Lane...>) noexcept {
+  uint64_t lanes[]{crcs[Lane]...};
+  uint8_t const *data[]{ps[Lane]...};
+  for (size_t i = 0; i < size / sizeof(uint64_t); ++i) {
+    ((lanes[Lane] = _mm_crc32_u64(
+          lanes[Lane], crc_load_word(data[Lane] + i * sizeof(uint64_t)))),
+     ...);
+  }
+  ((data[Lane] += size & ~(sizeof(uint64_t) - 1)), ...);
+
+  if (size & 4) {
+    uint32_t words[sizeof...(Lane)];
+    ((std::memcpy(&words[Lane], data[Lane], 4), data[Lane] += 4), ...);
+    ((lanes[Lane] =
+          _mm_crc32_u32(static_cast<uint32_t>(lanes[Lane]), words[Lane])),
+     ...);
+  }
+  if (size & 2) {
+    uint16_t words[sizeof...(Lane)];
+    ((std::memcpy(&words[Lane], data[Lane], 2), data[Lane] += 2), ...);
+    ((lanes[Lane] =
+          _mm_crc32_u16(static_cast<uint32_t>(lanes[Lane]), words[Lane])),
+     ...);
+  }
+  if (size & 1) {
+    ((lanes[Lane] =
+          _mm_crc32_u8(static_cast<uint32_t>(lanes[Lane]), *data[Lane])),
+     ...);
+  }
+  ((crcs[Lane] = lanes[Lane]), ...);
+}
+
+// the lanes go by 8 bytes in turn to keep the crc32 instruction busy as
+// long as the shortest one lasts, the rest of each is then updated on its own
+template <size_t Lanes>
+[[gnu::target("sse4.2")]] void crc32c_update_lanes(crc_lanes<Lanes> &lanes) {
+  auto const done{std::ranges::min(lanes.sizes)};
+  crc32c_words(lanes.crcs, lanes.ps, done, std::make_index_sequence<Lanes>{});
+
+  for (size_t lane = 0; lane < Lanes; ++lane) {
+    if (lanes.sizes[lane] != done) {
+      lanes.crcs[lane] = crc32c_update(
+          lanes.crcs[lane], lanes.ps[lane] + done, lanes.sizes[lane] - done);
+    }
+  }
+}
+
+// folding of the data of a reflected CRC with carry-less multiplication: a
+// 16-byte block B followed by n bits more is congruent to B_hi * x^(n+64) +
+// B_lo * x^n modulo the polynomial, which is 16 bytes again once the powers
+// are reduced; the blocks are folded over into the last one this way. In
+// the reflected order a product comes out one bit short, hence the constants
+// are the powers reduced less one
+template <size_t Bits, uint64_t Poly> class crc_folding {
+public:
+  // folds the 16-byte blocks of the data into the 16 bytes of rest whose CRC
+  // from zero is the CRC of the blocks from crc, returns the number of bytes
+  // folded; the data is to be 16 bytes at least
+  [[gnu::target("pclmul,sse4.1")]] static size_t
+  fold(uint64_t crc, uint8_t const *p, size_t size, uint8_t *rest) noexcept {
+    auto const *const begin{p};
+
+    auto x{_mm_xor_si128(load(p), _mm_cvtsi64_si128(crc))};
+    p += 16;
+    size -= 16;
+
+    if (!(size < 64)) {
+      __m128i xs[4]{x, load(p), load(p + 16), load(p + 32)};
+      p += 48;
+      size -= 48;
+
+      auto const k512{constants<512>()};
+      for (; !(size < 64); size -= 64, p += 64) {
+        for (size_t i = 0; i < 4; ++i)
+          xs[i] = _mm_xor_si128(fold_over(xs[i], k512), load(p + i * 16));
+      }
+
+      auto const k128{constants<128>()};
+      x = _mm_xor_si128(fold_over(xs[0], k128), xs[1]);
+      x = _mm_xor_si128(fold_over(x, k128), xs[2]);
+      x = _mm_xor_si128(fold_over(x, k128), xs[3]);
+    }
+
+    return fold_tail(x, begin, p, size, rest);
+  }
+
+  // fold over 32-byte registers, the data is to be 128 bytes at least
+  [[gnu::target("avx2,vpclmulqdq,pclmul,sse4.1")]] static size_t
+  fold_wide(uint64_t crc, uint8_t const *p, size_t size,
+            uint8_t *rest) noexcept {
+    auto const *const begin{p};
+
+    __m256i xs[4];
+    for (size_t i = 0; i < 4; ++i)
+      xs[i] = wide_load(p + i * 32);
+    xs[0] = _mm256_xor_si256(xs[0], _mm256_set_epi64x(0, 0, 0, crc));
+    p += 128;
+    size -= 128;
+
+    auto const k1024{wide_constants<1024>()};
+    for (; !(size < 128); size -= 128, p += 128) {
+      for (size_t i = 0; i < 4; ++i) {
+        xs[i] = _mm256_xor_si256(wide_fold_over(xs[i], k1024),
+                                 wide_load(p + i * 32));
+      }
+    }
+
+    auto const k256{wide_constants<256>()};
+    auto y{_mm256_xor_si256(wide_fold_over(xs[0], k256), xs[1])};
+    y = _mm256_xor_si256(wide_fold_over(y, k256), xs[2]);
+    y = _mm256_xor_si256(wide_fold_over(y, k256), xs[3]);
+
+    auto const x{_mm_xor_si128(fold_over(_mm256_castsi256_si128(y),
+                                         constants<128>()),
+                               _mm256_extracti128_si256(y, 1))};
+    return fold_tail(x, begin, p, size, rest);
+  }
+
+  // the lanes go by 16-byte blocks in turn to hide the latency of the
+  // multiplication as long as the shortest one lasts, the rest of each is
+  // then folded on its own and finished with the tables; the lanes are to
+  // be 32 bytes at least
+  template <size_t Lanes, typename TableUpdate>
+  [[gnu::target("pclmul,sse4.1")]] static void
+  fold_lanes(crc_lanes<Lanes> &lanes, TableUpdate table_update) {
+    __m128i xs[Lanes];
+    std::array<uint8_t const *, Lanes> ps;
+    for (size_t lane = 0; lane < Lanes; ++lane) {
+      xs[lane] = _mm_xor_si128(load(lanes.ps[lane]),
+                               _mm_cvtsi64_si128(lanes.crcs[lane]));
+      ps[lane] = lanes.ps[lane] + 16;
+    }
+
+    auto const blocks{std::ranges::min(lanes.sizes) / 16 - 1};
+    fold_blocks(xs, ps, blocks, std::make_index_sequence<Lanes>{});
+
+    auto const done{(blocks + 1) * 16};
+    for (size_t lane = 0; lane < Lanes; ++lane) {
+      uint8_t rest[16];
+      auto const folded{fold_tail(xs[lane], lanes.ps[lane],
+                                  lanes.ps[lane] + done,
+                                  lanes.sizes[lane] - done, rest)};
+      lanes.crcs[lane] =
+          table_update(table_update(0, rest, sizeof(rest)),
+                       lanes.ps[lane] + folded, lanes.sizes[lane] - folded);
+    }
+  }
+
+private:
+  // the multipliers of the low and the high halves of a block to move it N
+  // bits further
+  template <uint64_t N> struct constants_of {
+    static constexpr uint64_t lo{crc_reflect<64>(crc_xpow<Bits>(N + 63, Poly))};
+    static constexpr uint64_t hi{crc_reflect<64>(crc_xpow<Bits>(N - 1, Poly))};
+  };
+
+  template <uint64_t N>
+  [[gnu::target("pclmul,sse4.1")]] static __m128i constants() noexcept {
+    return _mm_set_epi64x(static_cast<int64_t>(constants_of<N>::hi),
+                          static_cast<int64_t>(constants_of<N>::lo));
+  }
+
+  template <uint64_t N>
+  [[gnu::target("avx2,vpclmulqdq,pclmul,sse4.1")]] static __m256i
+  wide_constants() noexcept {
+    return _mm256_broadcastsi128_si256(constants<N>());
+  }
+
+  [[gnu::target("pclmul,sse4.1")]] static __m128i
+  load(uint8_t const *p) noexcept {
+    return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+  }
+
+  [[gnu::target("avx2,vpclmulqdq,pclmul,sse4.1")]] static __m256i
+  wide_load(uint8_t const *p) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+  }
+
+  [[gnu::target("pclmul,sse4.1")]] static __m128i
+  fold_over(__m128i x, __m128i k) noexcept {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                         _mm_clmulepi64_si128(x, k, 0x11));
+  }
+
+  [[gnu::target("avx2,vpclmulqdq,pclmul,sse4.1")]] static __m256i
+  wide_fold_over(__m256i x, __m256i k) noexcept {
+    return _mm256_xor_si256(_mm256_clmulepi64_epi128(x, k, 0x00),
+                            _mm256_clmulepi64_epi128(x, k, 0x11));
+  }
+
+  // the lanes are spelt out for their blocks to be kept in registers
+  template <size_t... Lane>
+  [[gnu::target("pclmul,sse4.1")]] static void
+  fold_blocks(__m128i *xs,
+              std::array<uint8_t const *, sizeof...(Lane)> const &ps,
+              size_t blocks, std::index_sequence<Lane...>) noexcept {
+    auto const k128{constants<128>()};
+    __m128i lanes[]{xs[Lane]...};
+    uint8_t const *const data[]{ps[Lane]...};
+    for (size_t i = 0; i < blocks; ++i) {
+      ((lanes[Lane] = _mm_xor_si128(fold_over(lanes[Lane], k128),
+                                    load(data[Lane] + i * 16))),
+       ...);
+    }
+    ((xs[Lane] = lanes[Lane]), ...);
+  }
+
+  [[gnu::target("pclmul,sse4.1")]] static size_t
+  fold_tail(__m128i x, uint8_t const *begin, uint8_t const *p, size_t size,
+            uint8_t *rest) noexcept {
+    auto const k128{constants<128>()};
+    for (; !(size < 16); size -= 16, p += 16)
+      x = _mm_xor_si128(fold_over(x, k128), load(p));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(rest), x);
+    return p - begin;
+  }
+};
+
+// the data below the size is left to the tables
+inline constexpr size_t crc_accelerated_min_size{64};
+
+// updates the register of a reflected CRC if the CPU allows, table_update is
+// the CRC update with tables the folding is finished with
+template <size_t Bits, uint64_t Poly, typename TableUpdate>
+bool crc_update_accelerated(uint64_t &crc, uint8_t const *p, size_t size,
+                            TableUpdate table_update) noexcept {
+  if (size < crc_accelerated_min_size)
+    return false;
+
+  auto const &cpu{crc_cpu()};
+  if constexpr (32 == Bits && 0x1EDC6F41 == Poly) {
+    if (cpu.crc32c) [[likely]] {
+      crc = crc32c_update(crc, p, size);
+      return true;
+    }
+  }
+
+  if (!cpu.clmul) [[unlikely]]
+    return false;
+
+  uint8_t rest[16];
+  auto const folded{cpu.wide_clmul && !(size < 256)
+                        ? crc_folding<Bits, Poly>::fold_wide(crc, p, size, rest)
+                        : crc_folding<Bits, Poly>::fold(crc, p, size, rest)};
+  crc = table_update(table_update(0, rest, sizeof(rest)), p + folded,
+                     size - folded);
+  return true;
+}
+
+// buffers shorter than that are checksummed faster on their own: the CPU
+// overlaps the steps of a few independent buffers without being told
+template <size_t Bits, uint64_t Poly> size_t crc_lanes_min_size() noexcept {
+  auto const &cpu{crc_cpu()};
+  return cpu.clmul || (32 == Bits && 0x1EDC6F41 == Poly && cpu.crc32c) ? 256
+                                                                        : 0;
+}
+
+// buffers longer than that are checksummed faster on their own: the folding
+// over 32-byte registers outruns lanes of 16 bytes
+template <size_t Bits, uint64_t Poly> size_t crc_lanes_max_size() noexcept {
+  auto const &cpu{crc_cpu()};
+  if constexpr (32 == Bits && 0x1EDC6F41 == Poly) {
+    if (cpu.crc32c) [[likely]]
+      return SIZE_MAX;
+  }
+  return cpu.wide_clmul ? 2048 : SIZE_MAX;
+}
+
+// the same for independent buffers in lanes, see crc_lanes; the lanes are
+// to be crc_accelerated_min_size bytes at least
+template <size_t Bits, uint64_t Poly, size_t Lanes, typename TableUpdate>
+bool crc_update_lanes_accelerated(crc_lanes<Lanes> &lanes,
+                                  TableUpdate table_update) {
+  auto const &cpu{crc_cpu()};
+  if constexpr (32 == Bits && 0x1EDC6F41 == Poly) {
+    if (cpu.crc32c) [[likely]] {
+      crc32c_update_lanes(lanes);
+      return true;
+    }
+  }
+
+  if (!cpu.clmul) [[unlikely]]
+    return false;
+
+  crc_folding<Bits, Poly>::fold_lanes(lanes, table_update);
+  return true;
+}
+
+} // namespace xroost::detail
+
+#else
+
+namespace xroost::detail {
+
+template <size_t Bits, uint64_t Poly, typename TableUpdate>
+constexpr bool crc_update_accelerated(uint64_t &, uint8_t const *, size_t,
+                                      TableUpdate) noexcept {
+  return false;
+}
+
+template <size_t Bits, uint64_t Poly>
+constexpr size_t crc_lanes_min_size() noexcept {
+  return 0;
+}
+
+template <size_t Bits, uint64_t Poly>
+constexpr size_t crc_lanes_max_size() noexcept {
+  return SIZE_MAX;
+}
+
+template <size_t Bits, uint64_t Poly, size_t Lanes, typename TableUpdate>
+constexpr bool crc_update_lanes_accelerated(crc_lanes<Lanes> &, TableUpdate) {
+  return false;
+}
+
+} // namespace xroost::detail
+
+#endif
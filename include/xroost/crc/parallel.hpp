@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <concepts>
+
+#include <xroost/thread_pool.hpp>
+
+namespace xroost::crc {
+
+// a CRC whose checksums of consecutive parts make up the one of the whole
+template <typename CRC>
+concept combinable =
+    std::default_initializable<CRC> &&
+    requires(CRC crc, uint8_t const *p, size_t size,
+             typename CRC::CRCType checksum) {
+      crc(p, size);
+      { crc.checksum() } -> std::same_as<typename CRC::CRCType>;
+      {
+        CRC::combine(checksum, checksum, size)
+      } -> std::same_as<typename CRC::CRCType>;
+    };
+
+// the checksum of the data computed on the pool: the data is split in halves
+// forked until they are not longer than chunk bytes, the checksums of the
+// halves are combined as they are joined
+template <combinable CRC>
+typename CRC::CRCType parallel_checksum(thread_pool &pool, void const *data,
+                                        size_t size,
+                                        size_t chunk = size_t{1} << 20) {
+  auto const *const p{static_cast<uint8_t const *>(data)};
+
+  if (!(std::max(chunk, size_t{1}) < size)) {
+    CRC crc;
+    crc(p, size);
+    return crc.checksum();
+  }
+
+  auto const half{size / 2};
+  typename CRC::CRCType lo, hi;
+  pool.fork_join(
+      [&] { lo = parallel_checksum<CRC>(pool, p, half, chunk); },
+      [&] { hi = parallel_checksum<CRC>(pool, p + half, size - half, chunk); });
+  return CRC::combine(lo, hi, size - half);
+}
+
+} // namespace xroost::crc
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+
+#include <xroost/crc/crc_optimal.hpp>
+
+namespace xroost::detail {
+
+// the checksum of "123456789" the CRCs are catalogued by
+template <typename CRC> constexpr auto crc_check() {
+  constexpr char data[]{"123456789"};
+  CRC crc;
+  crc(data, sizeof(data) - 1);
+  return crc.checksum();
+}
+
+} // namespace xroost::detail
+
+namespace xroost::crc {
+
+// the common CRCs by their names in the catalogue of parametrised CRC
+// algorithms, along with the checksums of "123456789"
+
+// 0xF4
+using crc8 = crc_optimal<8, 0x07, 0x00, 0x00, false, false>;
+// 0xA1
+using crc8_maxim = crc_optimal<8, 0x31, 0x00, 0x00, true, true>;
+
+// 0xBB3D
+using crc16_arc = crc_optimal<16, 0x8005, 0x0000, 0x0000, true, true>;
+// 0x4B37
+using crc16_modbus = crc_optimal<16, 0x8005, 0xFFFF, 0x0000, true, true>;
+// 0x2189
+using crc16_kermit = crc_optimal<16, 0x1021, 0x0000, 0x0000, true, true>;
+// 0x31C3
+using crc16_xmodem = crc_optimal<16, 0x1021, 0x0000, 0x0000, false, false>;
+// 0x29B1
+using crc16_ccitt_false =
+    crc_optimal<16, 0x1021, 0xFFFF, 0x0000, false, false>;
+
+// 0xCBF43926
+using crc32 =
+    crc_optimal<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true, true>;
+// 0xFC891918
+using crc32_bzip2 =
+    crc_optimal<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, false, false>;
+// 0x0376E6E7
+using crc32_mpeg2 =
+    crc_optimal<32, 0x04C11DB7, 0xFFFFFFFF, 0x00000000, false, false>;
+// 0xE3069283
+using crc32c =
+    crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true>;
+
+// 0x6C40DF5F0B497347
+using crc64_ecma = crc_optimal<64, 0x42F0E1EBA9EA3693, 0x0000000000000000,
+                               0x0000000000000000, false, false>;
+// 0x995DC9BBDF1939FA
+using crc64_xz = crc_optimal<64, 0x42F0E1EBA9EA3693, 0xFFFFFFFFFFFFFFFF,
+                             0xFFFFFFFFFFFFFFFF, true, true>;
+
+static_assert(detail::crc_check<crc8>() == 0xF4);
+static_assert(detail::crc_check<crc8_maxim>() == 0xA1);
+static_assert(detail::crc_check<crc16_arc>() == 0xBB3D);
+static_assert(detail::crc_check<crc16_modbus>() == 0x4B37);
+static_assert(detail::crc_check<crc16_kermit>() == 0x2189);
+static_assert(detail::crc_check<crc16_xmodem>() == 0x31C3);
+static_assert(detail::crc_check<crc16_ccitt_false>() == 0x29B1);
+static_assert(detail::crc_check<crc32>() == 0xCBF43926);
+static_assert(detail::crc_check<crc32_bzip2>() == 0xFC891918);
+static_assert(detail::crc_check<crc32_mpeg2>() == 0x0376E6E7);
+static_assert(detail::crc_check<crc32c>() == 0xE3069283);
+static_assert(detail::crc_check<crc64_ecma>() == 0x6C40DF5F0B497347);
+static_assert(detail::crc_check<crc64_xz>() == 0x995DC9BBDF1939FA);
+
+} // namespace xroost::crc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 #include <algorithm>
 #include <array>
@@ -13,6 +14,14 @@ namespace xroost::endian {
 template <std::integral T> constexpr T byteswap(T value) {
   static_assert(std::has_unique_object_representations_v<T>,
                 "T may not have padding bits");
+#if defined(__GNUC__) || defined(__clang__)
+  if constexpr (2 == sizeof(T))
+    return static_cast<T>(__builtin_bswap16(static_cast<uint16_t>(value)));
+  else if constexpr (4 == sizeof(T))
+    return static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(value)));
+  else if constexpr (8 == sizeof(T))
+    return static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(value)));
+#endif
   auto array{std::bit_cast<std::array<std::byte, sizeof(T)>>(value)};
   std::ranges::reverse(array);
   return std::bit_cast<T>(array);
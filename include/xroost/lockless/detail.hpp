@@ -15,4 +15,12 @@ constexpr size_t hardware_destructive_interference_size{64};
 
 constexpr size_t is_power_of_2(size_t n) { return 0 == (n & (n - 1)); }
 
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
 } // namespace xroost::detail
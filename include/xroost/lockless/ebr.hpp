@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "detail.hpp"
+
+namespace xroost::detail {
+
+struct ebr_retired {
+  void *p;
+  void (*deleter)(void *);
+};
+
+struct alignas(hardware_destructive_interference_size) ebr_record {
+  static constexpr uint64_t pinned{1};
+
+  // the global epoch seen on pinning shifted left by one, the lowest bit set
+  // while the owner is pinned
+  std::atomic_uint64_t local;
+  std::atomic_bool in_use;
+  ebr_record *next;
+
+  // owner's data: the objects retired in each of the last three epochs
+  uint32_t nesting;
+  uint32_t retired_since_advance;
+  std::array<uint64_t, 3> limbo_epoch;
+  std::array<std::vector<ebr_retired>, 3> limbo;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// epoch-based reclamation: a thread pins the current epoch while it reads
+// shared objects and retires the objects it has unlinked; the global epoch
+// moves on once every pinned thread has seen it, an object retired in the
+// epoch e is deleted by its retirer as soon as the global epoch reaches e+2
+// since nobody can reach it any longer. Retired objects are kept per thread
+// in three limbo lists, one per epoch, and the epoch is tried to be advanced
+// once in batch retirements
+class ebr_domain {
+public:
+  class guard;
+
+  // a thread's registration in the domain, it is to be used by one thread at
+  // a time; the objects retired through a handle detached are reclaimed by
+  // the handle taking its record over next
+  class handle {
+  public:
+    handle(handle &&other) noexcept
+        : domain_(other.domain_), record_(std::exchange(other.record_, {})) {}
+    handle &operator=(handle &&other) noexcept {
+      if (this != &other) {
+        detach();
+        domain_ = other.domain_;
+        record_ = std::exchange(other.record_, {});
+      }
+      return *this;
+    }
+    ~handle() { detach(); }
+
+    handle(handle const &) = delete;
+    handle &operator=(handle const &) = delete;
+
+    // the objects read through the shared pointers stay alive while the
+    // guard is, guards nest
+    [[nodiscard]] guard pin() noexcept { return guard{*this}; }
+
+    // deleter(p) is called once nobody can be reading the object
+    void retire(void *p, void (*deleter)(void *)) {
+      // the object has been unlinked before the epoch is read
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto const epoch{domain_->epoch_.load(std::memory_order_relaxed)};
+
+      auto const i{epoch % 3};
+      if (record_->limbo_epoch[i] != epoch) {
+        // the list holds objects retired at least 3 epochs ago
+        reclaim(i);
+        record_->limbo_epoch[i] = epoch;
+      }
+      record_->limbo[i].push_back({p, deleter});
+
+      if (!(++record_->retired_since_advance < domain_->batch_)) {
+        record_->retired_since_advance = 0;
+        collect();
+      }
+    }
+
+    template <typename T> void retire(T *p) {
+      retire(p, [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    // tries to move the epoch on and deletes whatever is safe to delete
+    void collect() {
+      domain_->try_advance();
+      auto const epoch{domain_->epoch_.load(std::memory_order_acquire)};
+      for (size_t i = 0; i < record_->limbo.size(); ++i) {
+        if (!(epoch < record_->limbo_epoch[i] + 2))
+          reclaim(i);
+      }
+    }
+
+  private:
+    friend class ebr_domain;
+    friend class guard;
+
+    handle(ebr_domain &domain, detail::ebr_record *record) noexcept
+        : domain_(&domain), record_(record) {}
+
+    void reclaim(size_t i) {
+      for (auto const &r : record_->limbo[i])
+        r.deleter(r.p);
+      record_->limbo[i].clear();
+    }
+
+    void detach() noexcept {
+      if (record_)
+        std::exchange(record_, {})->in_use.store(false,
+                                                 std::memory_order_release);
+    }
+
+    ebr_domain *domain_;
+    detail::ebr_record *record_;
+  };
+
+  class guard {
+  public:
+    ~guard() {
+      if (0 == --record_->nesting)
+        record_->local.store(record_->local.load(std::memory_order_relaxed) &
+                                 ~detail::ebr_record::pinned,
+                             std::memory_order_release);
+    }
+
+    guard(guard const &) = delete;
+    guard &operator=(guard const &) = delete;
+
+    guard(guard &&) = delete;
+    guard &operator=(guard &&) = delete;
+
+  private:
+    friend class handle;
+
+    explicit guard(handle &h) noexcept : record_(h.record_) {
+      if (0 != record_->nesting++)
+        return;
+
+      auto &global{h.domain_->epoch_};
+      for (auto epoch{global.load(std::memory_order_relaxed)};;) {
+        record_->local.store(epoch << 1 | detail::ebr_record::pinned,
+                             std::memory_order_relaxed);
+        // the pin is visible before any shared pointer is read; should the
+        // epoch have moved on meanwhile, the pin might have been missed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const now{global.load(std::memory_order_relaxed)};
+        if (now == epoch) [[likely]]
+          break;
+        epoch = now;
+      }
+    }
+
+    detail::ebr_record *record_;
+  };
+
+  explicit ebr_domain(uint32_t batch = 64) : batch_(batch) {}
+  ~ebr_domain() {
+    for (auto *r{records_.load(std::memory_order_acquire)}; r;) {
+      for (auto &limbo : r->limbo) {
+        for (auto const &retired : limbo)
+          retired.deleter(retired.p);
+      }
+      delete std::exchange(r, r->next);
+    }
+  }
+
+  ebr_domain(ebr_domain const &) = delete;
+  ebr_domain &operator=(ebr_domain const &) = delete;
+
+  ebr_domain(ebr_domain &&) = delete;
+  ebr_domain &operator=(ebr_domain &&) = delete;
+
+  // registers the calling thread, a record released by a handle detached is
+  // reused if there is any
+  [[nodiscard]] handle attach() {
+    for (auto *r{records_.load(std::memory_order_acquire)}; r; r = r->next) {
+      if (!r->in_use.load(std::memory_order_relaxed) &&
+          !r->in_use.exchange(true, std::memory_order_acquire))
+        return {*this, r};
+    }
+
+    auto *const r{new detail::ebr_record{}};
+    r->in_use.store(true, std::memory_order_relaxed);
+    r->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(r->next, r,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    return {*this, r};
+  }
+
+private:
+  // the epoch moves on if every thread pinned has seen the current one
+  void try_advance() noexcept {
+    auto epoch{epoch_.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (auto *r{records_.load(std::memory_order_acquire)}; r; r = r->next) {
+      auto const local{r->local.load(std::memory_order_acquire)};
+      if ((local & detail::ebr_record::pinned) && (local >> 1) != epoch)
+        return;
+    }
+
+    epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel,
+                                   std::memory_order_relaxed);
+  }
+
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_uint64_t epoch_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic<detail::ebr_record *> records_;
+  uint32_t const batch_;
+};
+
+} // namespace xroost::lockless
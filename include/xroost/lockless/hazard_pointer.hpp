@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "detail.hpp"
+
+namespace xroost::detail {
+
+struct hazard_retired {
+  void *p;
+  void (*deleter)(void *);
+};
+
+struct alignas(hardware_destructive_interference_size) hazard_record {
+  explicit hazard_record(size_t slots)
+      : hazards(std::make_unique<std::atomic<void *>[]>(slots)) {}
+
+  std::unique_ptr<std::atomic<void *>[]> hazards;
+  std::atomic_bool in_use;
+  hazard_record *next{};
+
+  // owner's objects retired and not deleted yet
+  std::vector<hazard_retired> retired;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// hazard pointers: before dereferencing a shared pointer a thread publishes
+// it in one of its slots, an object retired is only deleted once it is found
+// in no thread's slot; the retirer scans the slots once it has retired
+// twice as many objects as there are slots in total, so that there are at
+// most that many objects waiting to be deleted per thread
+class hazard_domain {
+public:
+  // a thread's registration in the domain with slots_per_thread slots, it is
+  // to be used by one thread at a time
+  class handle {
+  public:
+    handle(handle &&other) noexcept
+        : domain_(other.domain_), record_(std::exchange(other.record_, {})) {}
+    handle &operator=(handle &&other) noexcept {
+      if (this != &other) {
+        detach();
+        domain_ = other.domain_;
+        record_ = std::exchange(other.record_, {});
+      }
+      return *this;
+    }
+    ~handle() { detach(); }
+
+    handle(handle const &) = delete;
+    handle &operator=(handle const &) = delete;
+
+    // reads src and publishes the pointer read in the slot until it is read
+    // from src again, the object stays alive until the slot is cleared or
+    // reused
+    template <typename T>
+    T *protect(std::atomic<T *> const &src, size_t slot) noexcept {
+      auto &hazard{record_->hazards[slot]};
+      for (auto *p{src.load(std::memory_order_relaxed)};;) {
+        hazard.store(p, std::memory_order_seq_cst);
+        // an acquire load might be taken before the store, a retirer
+        // missing the hazard then while the pointer is still read again
+        auto *const again{src.load(std::memory_order_seq_cst)};
+        if (again == p) [[likely]]
+          return p;
+        p = again;
+      }
+    }
+
+    void clear(size_t slot) noexcept {
+      record_->hazards[slot].store(nullptr, std::memory_order_release);
+    }
+
+    // deleter(p) is called once p is found in no slot
+    void retire(void *p, void (*deleter)(void *)) {
+      record_->retired.push_back({p, deleter});
+      if (!(record_->retired.size() < domain_->threshold()))
+        collect();
+    }
+
+    template <typename T> void retire(T *p) {
+      retire(p, [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    // deletes the objects retired that are not protected
+    void collect() {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      auto hazards{domain_->hazards()};
+      std::ranges::sort(hazards);
+
+      auto const unprotected{std::ranges::partition(
+          record_->retired, [&hazards](auto const &r) {
+            return std::ranges::binary_search(hazards, r.p);
+          })};
+      for (auto const &r : unprotected)
+        r.deleter(r.p);
+      record_->retired.erase(unprotected.begin(), unprotected.end());
+    }
+
+  private:
+    friend class hazard_domain;
+
+    handle(hazard_domain &domain, detail::hazard_record *record) noexcept
+        : domain_(&domain), record_(record) {}
+
+    void detach() noexcept {
+      if (!record_)
+        return;
+      for (size_t i = 0; i < domain_->slots_; ++i)
+        record_->hazards[i].store(nullptr, std::memory_order_relaxed);
+      std::exchange(record_, {})->in_use.store(false,
+                                               std::memory_order_release);
+    }
+
+    hazard_domain *domain_;
+    detail::hazard_record *record_;
+  };
+
+  explicit hazard_domain(size_t slots_per_thread = 2)
+      : slots_(slots_per_thread) {}
+  ~hazard_domain() {
+    for (auto *r{records_.load(std::memory_order_acquire)}; r;) {
+      for (auto const &retired : r->retired)
+        retired.deleter(retired.p);
+      delete std::exchange(r, r->next);
+    }
+  }
+
+  hazard_domain(hazard_domain const &) = delete;
+  hazard_domain &operator=(hazard_domain const &) = delete;
+
+  hazard_domain(hazard_domain &&) = delete;
+  hazard_domain &operator=(hazard_domain &&) = delete;
+
+  [[nodiscard]] size_t slots_per_thread() const noexcept { return slots_; }
+
+  // registers the calling thread, a record released by a handle detached is
+  // reused if there is any
+  [[nodiscard]] handle attach() {
+    for (auto *r{records_.load(std::memory_order_acquire)}; r; r = r->next) {
+      if (!r->in_use.load(std::memory_order_relaxed) &&
+          !r->in_use.exchange(true, std::memory_order_acquire))
+        return {*this, r};
+    }
+
+    auto *const r{new detail::hazard_record{slots_}};
+    r->in_use.store(true, std::memory_order_relaxed);
+    r->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(r->next, r,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    records_count_.fetch_add(1, std::memory_order_relaxed);
+    return {*this, r};
+  }
+
+private:
+  size_t threshold() const noexcept {
+    return 2 * slots_ * records_count_.load(std::memory_order_relaxed) + 1;
+  }
+
+  // the pointers published by every thread
+  std::vector<void *> hazards() const {
+    std::vector<void *> hazards;
+    for (auto *r{records_.load(std::memory_order_acquire)}; r; r = r->next) {
+      for (size_t i = 0; i < slots_; ++i) {
+        if (auto *const p{r->hazards[i].load(std::memory_order_acquire)})
+          hazards.push_back(p);
+      }
+    }
+    return hazards;
+  }
+
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic<detail::hazard_record *> records_;
+  std::atomic_size_t records_count_;
+  size_t const slots_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <xroost/utility/aligned_storage.hpp>
+
+#include "detail.hpp"
+#include "stats_policy.hpp"
+#include "wait_policy.hpp"
+
+namespace xroost::detail {
+
+// a slot is free to be written at the position pos when its sequence number
+// equals pos, it holds an item to be read at pos when the sequence number
+// equals pos + 1
+template <typename T> struct mpmcslot {
+  std::atomic_size_t seq;
+  aligned_storage_t<T> storage;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+template <typename T, size_t N, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
+class static_mpmcqueue {
+  // a slot full at pos would look free at pos + 1 with a single slot
+  static_assert(1 < N, "xroost::static_mpmcqueue: capacity is less than 2");
+
+public:
+  static_mpmcqueue() {
+    for (size_t i = 0; i < items_.size(); ++i)
+      items_[i].seq.store(i, std::memory_order_relaxed);
+  }
+  ~static_mpmcqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ++ch)
+      std::destroy_at(item(ch));
+  }
+
+  static_mpmcqueue(static_mpmcqueue const &) = delete;
+  static_mpmcqueue &operator=(static_mpmcqueue const &) = delete;
+
+  static_mpmcqueue(static_mpmcqueue &&) = delete;
+  static_mpmcqueue &operator=(static_mpmcqueue &&) = delete;
+
+  [[nodiscard]] static constexpr uint32_t capacity() { return N; }
+
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                  std::is_nothrow_destructible_v<T>) {
+    std::optional<T> v;
+
+    auto ch{head_.load(std::memory_order_relaxed)};
+    for (;;) {
+      auto const seq{
+          items_[index_of(ch)].seq.load(std::memory_order_acquire)};
+      if (auto const diff{static_cast<ptrdiff_t>(seq - (ch + 1))}; 0 == diff) {
+        if (head_.compare_exchange_weak(ch, ch + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        pop_stats_.miss();
+        return v;
+      } else {
+        ch = head_.load(std::memory_order_relaxed);
+      }
+      pop_stats_.retry();
+    }
+
+    auto &slot{items_[index_of(ch)]};
+    auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    slot.seq.store(ch + capacity(), std::memory_order_release);
+    pops_.bump();
+    push_waiters_.notify_all(pops_);
+    pop_stats_.count();
+
+    return v;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
+    auto ct{tail_.load(std::memory_order_relaxed)};
+    for (;;) {
+      auto const seq{
+          items_[index_of(ct)].seq.load(std::memory_order_acquire)};
+      if (auto const diff{static_cast<ptrdiff_t>(seq - ct)}; 0 == diff) {
+        if (tail_.compare_exchange_weak(ct, ct + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        push_stats_.miss();
+        return false;
+      } else {
+        ct = tail_.load(std::memory_order_relaxed);
+      }
+      push_stats_.retry();
+    }
+
+    auto &slot{items_[index_of(ct)]};
+    std::construct_at(reinterpret_cast<T *>(slot.storage.data),
+                      std::forward<Args>(args)...);
+    slot.seq.store(ct + 1, std::memory_order_release);
+    pushes_.bump();
+    pop_waiters_.notify_all(pushes_);
+    push_stats_.count();
+    if (push_stats_.sample()) {
+      auto const ch{head_.load(std::memory_order_relaxed)};
+      push_stats_.water(ch < ct + 1 ? ct + 1 - ch : 0);
+    }
+
+    return true;
+  }
+
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); },
+                                        [this] { return pushes_.watch(); }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait([&] { return emplace(std::forward<Args>(args)...); },
+                       [this] { return pops_.watch(); });
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
+private:
+  static size_t index_of(size_t pos) {
+    if constexpr (detail::is_power_of_2(capacity()))
+      return pos & (capacity() - 1);
+    else
+      return pos % capacity();
+  }
+
+  T *item(size_t pos) noexcept {
+    return std::launder(
+        reinterpret_cast<T *>(items_[index_of(pos)].storage.data));
+  }
+
+  // each side's counters share the line the side contends for anyway
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t head_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> pop_stats_;
+  // the waiters park on these rather than on a slot: the slot at head_ or
+  // tail_ may have been taken by another thread by the time it is read,
+  // and the next change would then be to another slot
+  [[no_unique_address]] detail::waitcount<WaitPolicy> pops_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t tail_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> push_stats_;
+  [[no_unique_address]] detail::waitcount<WaitPolicy> pushes_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::array<detail::mpmcslot<T>, capacity()> items_;
+};
+
+template <typename T, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
+class mpmcqueue {
+public:
+  explicit mpmcqueue(size_t capacity)
+      : capacity_(capacity),
+        mask_(detail::is_power_of_2(capacity_) ? capacity_ - 1 : 0),
+        items_(std::make_unique<detail::mpmcslot<T>[]>(capacity_)) {
+    // a slot full at pos would look free at pos + 1 with a single slot
+    if (capacity_ < 2)
+      throw std::length_error("xroost::mpmcqueue: capacity is less than 2");
+
+    for (size_t i = 0; i < capacity_; ++i)
+      items_[i].seq.store(i, std::memory_order_relaxed);
+  }
+  ~mpmcqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ++ch)
+      std::destroy_at(item(ch));
+  }
+
+  mpmcqueue(mpmcqueue const &) = delete;
+  mpmcqueue &operator=(mpmcqueue const &) = delete;
+
+  mpmcqueue(mpmcqueue &&) = delete;
+  mpmcqueue &operator=(mpmcqueue &&) = delete;
+
+  [[nodiscard]] uint32_t capacity() const { return capacity_; }
+
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                  std::is_nothrow_destructible_v<T>) {
+    std::optional<T> v;
+
+    auto ch{head_.load(std::memory_order_relaxed)};
+    for (;;) {
+      auto const seq{
+          items_[index_of(ch)].seq.load(std::memory_order_acquire)};
+      if (auto const diff{static_cast<ptrdiff_t>(seq - (ch + 1))}; 0 == diff) {
+        if (head_.compare_exchange_weak(ch, ch + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        pop_stats_.miss();
+        return v;
+      } else {
+        ch = head_.load(std::memory_order_relaxed);
+      }
+      pop_stats_.retry();
+    }
+
+    auto &slot{items_[index_of(ch)]};
+    auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    slot.seq.store(ch + capacity_, std::memory_order_release);
+    pops_.bump();
+    push_waiters_.notify_all(pops_);
+    pop_stats_.count();
+
+    return v;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
+    auto ct{tail_.load(std::memory_order_relaxed)};
+    for (;;) {
+      auto const seq{
+          items_[index_of(ct)].seq.load(std::memory_order_acquire)};
+      if (auto const diff{static_cast<ptrdiff_t>(seq - ct)}; 0 == diff) {
+        if (tail_.compare_exchange_weak(ct, ct + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        push_stats_.miss();
+        return false;
+      } else {
+        ct = tail_.load(std::memory_order_relaxed);
+      }
+      push_stats_.retry();
+    }
+
+    auto &slot{items_[index_of(ct)]};
+    std::construct_at(reinterpret_cast<T *>(slot.storage.data),
+                      std::forward<Args>(args)...);
+    slot.seq.store(ct + 1, std::memory_order_release);
+    pushes_.bump();
+    pop_waiters_.notify_all(pushes_);
+    push_stats_.count();
+    if (push_stats_.sample()) {
+      auto const ch{head_.load(std::memory_order_relaxed)};
+      push_stats_.water(ch < ct + 1 ? ct + 1 - ch : 0);
+    }
+
+    return true;
+  }
+
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); },
+                                        [this] { return pushes_.watch(); }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait([&] { return emplace(std::forward<Args>(args)...); },
+                       [this] { return pops_.watch(); });
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
+private:
+  size_t index_of(size_t pos) const {
+    return mask_ ? pos & mask_ : pos % capacity_;
+  }
+
+  T *item(size_t pos) noexcept {
+    return std::launder(
+        reinterpret_cast<T *>(items_[index_of(pos)].storage.data));
+  }
+
+  // each side's counters share the line the side contends for anyway
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t head_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> pop_stats_;
+  // the waiters park on these rather than on a slot: the slot at head_ or
+  // tail_ may have been taken by another thread by the time it is read,
+  // and the next change would then be to another slot
+  [[no_unique_address]] detail::waitcount<WaitPolicy> pops_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t tail_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> push_stats_;
+  [[no_unique_address]] detail::waitcount<WaitPolicy> pushes_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
+  alignas(detail::hardware_destructive_interference_size) size_t const
+      capacity_;
+  // capacity_ - 1 if capacity_ is a power of 2, 0 otherwise
+  size_t const mask_;
+  std::unique_ptr<detail::mpmcslot<T>[]> items_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "detail.hpp"
+
+namespace xroost::lockless {
+
+// a slab of capacity blocks of block_size bytes aligned to align each, any
+// thread takes blocks from the pool and gives them back; the free blocks form
+// a Treiber stack linked by indices, the head keeps the index of the top
+// block along with a generation bumped by every change so that a stale head
+// never passes the CAS (ABA), both taking and giving back are a single CAS
+class block_pool {
+public:
+  block_pool(size_t block_size, size_t capacity,
+             size_t align = alignof(std::max_align_t))
+      : align_(std::max(align, alignof(uint32_t))),
+        stride_((std::max(block_size, size_t{1}) + align_ - 1) / align_ *
+                align_),
+        capacity_(capacity),
+        next_(std::make_unique<std::atomic_uint32_t[]>(capacity_)) {
+    if (!(capacity_ < nil))
+      throw std::length_error("xroost::block_pool: capacity is too large");
+
+    slab_ = static_cast<std::byte *>(
+        ::operator new(stride_ * capacity_, std::align_val_t{align_}));
+
+    for (size_t i = 0; i < capacity_; ++i)
+      next_[i].store(i + 1 < capacity_ ? i + 1 : nil,
+                     std::memory_order_relaxed);
+    head_.store(capacity_ ? 0 : nil, std::memory_order_relaxed);
+  }
+  ~block_pool() { ::operator delete(slab_, std::align_val_t{align_}); }
+
+  block_pool(block_pool const &) = delete;
+  block_pool &operator=(block_pool const &) = delete;
+
+  block_pool(block_pool &&) = delete;
+  block_pool &operator=(block_pool &&) = delete;
+
+  [[nodiscard]] size_t block_size() const noexcept { return stride_; }
+  [[nodiscard]] size_t block_align() const noexcept { return align_; }
+  [[nodiscard]] size_t capacity() const noexcept { return capacity_; }
+
+  // a free block or nullptr if there are none left
+  [[nodiscard]] void *allocate() noexcept {
+    auto head{head_.load(std::memory_order_acquire)};
+    for (;;) {
+      auto const top{index_of(head)};
+      if (nil == top) [[unlikely]]
+        return nullptr;
+
+      // might be stale if the block is taken concurrently, the CAS fails then
+      auto const next{next_[top].load(std::memory_order_relaxed)};
+      if (head_.compare_exchange_weak(head, pack(next, head),
+                                      std::memory_order_acquire,
+                                      std::memory_order_acquire))
+        return slab_ + top * stride_;
+    }
+  }
+
+  void deallocate(void *p) noexcept {
+    auto const i{static_cast<uint32_t>(
+        (static_cast<std::byte *>(p) - slab_) / stride_)};
+
+    auto head{head_.load(std::memory_order_relaxed)};
+    do {
+      next_[i].store(index_of(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(i, head),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  [[nodiscard]] bool owns(void const *p) const noexcept {
+    auto const *const b{static_cast<std::byte const *>(p)};
+    return !(b < slab_) && b < slab_ + stride_ * capacity_;
+  }
+
+private:
+  static constexpr uint32_t nil{std::numeric_limits<uint32_t>::max()};
+
+  static uint32_t index_of(uint64_t head) noexcept {
+    return static_cast<uint32_t>(head);
+  }
+
+  // the head with the top block i and the generation next to the one of prev
+  static uint64_t pack(uint32_t i, uint64_t prev) noexcept {
+    return ((prev >> 32) + 1) << 32 | i;
+  }
+
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_uint64_t head_;
+  alignas(detail::hardware_destructive_interference_size) size_t const align_;
+  size_t const stride_;
+  size_t const capacity_;
+  std::unique_ptr<std::atomic_uint32_t[]> next_;
+  std::byte *slab_;
+};
+
+// capacity objects of type T constructed in the blocks of a block_pool
+template <typename T>
+  requires std::destructible<T>
+class object_pool {
+public:
+  explicit object_pool(size_t capacity)
+      : blocks_(sizeof(T), capacity, alignof(T)) {}
+  ~object_pool() = default;
+
+  object_pool(object_pool const &) = delete;
+  object_pool &operator=(object_pool const &) = delete;
+
+  object_pool(object_pool &&) = delete;
+  object_pool &operator=(object_pool &&) = delete;
+
+  [[nodiscard]] size_t capacity() const noexcept { return blocks_.capacity(); }
+
+  // nullptr if the pool is exhausted
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  [[nodiscard]] T *construct(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
+    auto *const p{blocks_.allocate()};
+    if (!p) [[unlikely]]
+      return nullptr;
+
+    if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+      return std::construct_at(static_cast<T *>(p),
+                               std::forward<Args>(args)...);
+    } else {
+      try {
+        return std::construct_at(static_cast<T *>(p),
+                                 std::forward<Args>(args)...);
+      } catch (...) {
+        blocks_.deallocate(p);
+        throw;
+      }
+    }
+  }
+
+  void destroy(T *p) noexcept(std::is_nothrow_destructible_v<T>) {
+    std::destroy_at(p);
+    blocks_.deallocate(p);
+  }
+
+private:
+  block_pool blocks_;
+};
+
+// allocates single objects from the pool and throws std::bad_alloc once it
+// is exhausted, a single object too large for a block of the pool, such as
+// the node of a container rebinding the allocator, throws std::length_error
+// rather than going unnoticed elsewhere; arrays are left to std::allocator
+template <typename T> class pool_allocator {
+public:
+  using value_type = T;
+
+  explicit pool_allocator(block_pool &pool) noexcept : pool_(&pool) {}
+  template <typename U>
+  pool_allocator(pool_allocator<U> const &other) noexcept
+      : pool_(other.pool_) {}
+
+  [[nodiscard]] T *allocate(size_t n) {
+    if (1 != n) [[unlikely]]
+      return std::allocator<T>{}.allocate(n);
+    if (!fits()) [[unlikely]] {
+      throw std::length_error(
+          "xroost::pool_allocator: the object does not fit a block");
+    }
+
+    auto *const p{pool_->allocate()};
+    if (!p) [[unlikely]]
+      throw std::bad_alloc{};
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    if (!p) [[unlikely]]
+      return;
+
+    if (pool_->owns(p)) [[likely]]
+      pool_->deallocate(p);
+    else
+      std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(pool_allocator<U> const &other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+private:
+  template <typename U> friend class pool_allocator;
+
+  bool fits() const noexcept {
+    return !(pool_->block_size() < sizeof(T)) &&
+           !(pool_->block_align() < alignof(T));
+  }
+
+  block_pool *pool_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <optional>
+#include <type_traits>
+
+#include "detail.hpp"
+
+namespace xroost::detail {
+
+// a trivially copyable value kept in relaxed atomic words, so that a reader
+// racing with the writer sees torn data rather than a data race
+template <typename T> class seqlock_words {
+public:
+  void write(T const &v) noexcept {
+    std::array<uint64_t, words_count> words{};
+    std::memcpy(words.data(), &v, sizeof(T));
+    for (size_t i = 0; i < words_count; ++i)
+      words_[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  T read() const noexcept {
+    std::array<uint64_t, words_count> words;
+    for (size_t i = 0; i < words_count; ++i)
+      words[i] = words_[i].load(std::memory_order_relaxed);
+
+    std::array<std::byte, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), words.data(), sizeof(T));
+    return std::bit_cast<T>(bytes);
+  }
+
+private:
+  static constexpr size_t words_count{(sizeof(T) + sizeof(uint64_t) - 1) /
+                                      sizeof(uint64_t)};
+
+  std::array<std::atomic_uint64_t, words_count> words_;
+};
+
+// a slot of versioned_seqlock, its sequence number is 2 * version + 1 while
+// the version is being written and 2 * version + 2 once it is written
+template <typename T>
+struct alignas(hardware_destructive_interference_size) seqlock_slot {
+  std::atomic_uint64_t seq;
+  seqlock_words<T> data;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// the latest value published by one writer to many readers: the writer never
+// waits, a reader retries if the writer has changed the value while it was
+// being read
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class alignas(detail::hardware_destructive_interference_size) seqlock {
+public:
+  seqlock()
+    requires std::default_initializable<T>
+      : seqlock(T{}) {}
+  explicit seqlock(T const &v) noexcept { data_.write(v); }
+  ~seqlock() = default;
+
+  seqlock(seqlock const &) = delete;
+  seqlock &operator=(seqlock const &) = delete;
+
+  seqlock(seqlock &&) = delete;
+  seqlock &operator=(seqlock &&) = delete;
+
+  // writer only
+  void store(T const &v) noexcept {
+    auto const seq{seq_.load(std::memory_order_relaxed)};
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    // the odd sequence number goes before the data
+    std::atomic_thread_fence(std::memory_order_release);
+    data_.write(v);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // fails if the value is being changed
+  std::optional<T> try_load() const noexcept {
+    std::optional<T> v;
+
+    auto const seq{seq_.load(std::memory_order_acquire)};
+    if (seq & 1) [[unlikely]]
+      return v;
+
+    auto const data{data_.read()};
+    // the data goes before the sequence number is read again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) == seq) [[likely]]
+      v.emplace(data);
+
+    return v;
+  }
+
+  T load() const noexcept {
+    for (;;) {
+      if (auto v{try_load()}) [[likely]]
+        return *v;
+      detail::cpu_relax();
+    }
+  }
+
+private:
+  std::atomic_uint64_t seq_;
+  detail::seqlock_words<T> data_;
+};
+
+// the writer writes every new version into the next of Slots slots and
+// publishes its number then, so that readers keep reading the latest version
+// undisturbed while the next one is being written; a reader only retries if
+// the writer has gone through all the slots while it was reading
+template <typename T, size_t Slots = 4>
+  requires(std::is_trivially_copyable_v<T> && 1 < Slots)
+class versioned_seqlock {
+public:
+  versioned_seqlock()
+    requires std::default_initializable<T>
+      : versioned_seqlock(T{}) {}
+  explicit versioned_seqlock(T const &v) noexcept {
+    slots_[0].data.write(v);
+    slots_[0].seq.store(2, std::memory_order_relaxed);
+  }
+  ~versioned_seqlock() = default;
+
+  versioned_seqlock(versioned_seqlock const &) = delete;
+  versioned_seqlock &operator=(versioned_seqlock const &) = delete;
+
+  versioned_seqlock(versioned_seqlock &&) = delete;
+  versioned_seqlock &operator=(versioned_seqlock &&) = delete;
+
+  // writer only
+  void store(T const &v) noexcept {
+    auto const version{version_.load(std::memory_order_relaxed) + 1};
+    auto &slot{slots_[version % Slots]};
+
+    slot.seq.store(2 * version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.data.write(v);
+    slot.seq.store(2 * version + 2, std::memory_order_release);
+    version_.store(version, std::memory_order_release);
+  }
+
+  // fails if the slot of the latest version is being reused
+  std::optional<T> try_load() const noexcept {
+    std::optional<T> v;
+
+    auto const version{version_.load(std::memory_order_acquire)};
+    auto const &slot{slots_[version % Slots]};
+
+    auto const seq{slot.seq.load(std::memory_order_acquire)};
+    if (seq != 2 * version + 2) [[unlikely]]
+      return v;
+
+    auto const data{slot.data.read()};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) == seq) [[likely]]
+      v.emplace(data);
+
+    return v;
+  }
+
+  T load() const noexcept {
+    for (;;) {
+      if (auto v{try_load()}) [[likely]]
+        return *v;
+      detail::cpu_relax();
+    }
+  }
+
+  // the number of the stores done so far
+  [[nodiscard]] uint64_t version() const noexcept {
+    return version_.load(std::memory_order_acquire);
+  }
+
+private:
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_uint64_t version_;
+  std::array<detail::seqlock_slot<T>, Slots> slots_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace xroost::detail {
+
+// the line the shared indices are kept apart by: fixed rather than
+// hardware_destructive_interference_size, which depends on the compiler and
+// its flags while the processes sharing a queue must agree on its layout
+inline constexpr size_t shm_line_size{64};
+
+// the beginning of the mapping, the slots follow it
+struct shm_spscheader {
+  static constexpr uint64_t magic_value{0x78726f6f73747370};
+  static constexpr uint32_t layout_version{2};
+
+  // written last by the creator, an attacher sees either zero or the whole
+  // header initialized
+  uint64_t magic;
+  uint32_t version;
+  uint32_t item_size;
+  uint32_t item_align;
+  uint32_t size;
+  alignas(shm_line_size) std::atomic_uint32_t head;
+  alignas(shm_line_size) std::atomic_uint32_t tail;
+};
+
+static_assert(sizeof(shm_spscheader) == 3 * shm_line_size);
+
+static_assert(std::atomic_uint32_t::is_always_lock_free);
+
+[[noreturn]] inline void throw_errno(char const *what) {
+  throw std::system_error(errno, std::system_category(), what);
+}
+
+// closes the descriptor unless it is released
+struct fd_guard {
+  ~fd_guard() {
+    if (!(fd < 0))
+      ::close(fd);
+  }
+  int release() noexcept { return std::exchange(fd, -1); }
+  int fd;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// the spsc ring living in a shared memory object so that the producer and the
+// consumer might be different processes: one of them creates the queue, the
+// other attaches to it by name or by the descriptor inherited or received
+// over a unix socket; the indices each side caches are kept out of the
+// mapping, in the process' own queue object. There is no blocking flavour
+// since std::atomic::wait is process private
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class shm_spscqueue {
+public:
+  // creates the POSIX shared memory object name, fails if it exists
+  static shm_spscqueue create(std::string const &name, size_t capacity) {
+    detail::fd_guard fd{
+        ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)};
+    if (fd.fd < 0)
+      detail::throw_errno("shm_open");
+
+    try {
+      return shm_spscqueue{fd, capacity, false};
+    } catch (...) {
+      ::shm_unlink(name.c_str());
+      throw;
+    }
+  }
+
+  // creates an anonymous memory file, its descriptor fd() is to be handed
+  // over to the other side
+  static shm_spscqueue create_anonymous(size_t capacity) {
+    detail::fd_guard fd{::memfd_create("xroost_shm_spscqueue", MFD_CLOEXEC)};
+    if (fd.fd < 0)
+      detail::throw_errno("memfd_create");
+
+    return shm_spscqueue{fd, capacity, true};
+  }
+
+  static shm_spscqueue attach(std::string const &name) {
+    detail::fd_guard fd{::shm_open(name.c_str(), O_RDWR, 0)};
+    if (fd.fd < 0)
+      detail::throw_errno("shm_open");
+    return shm_spscqueue{fd.fd};
+  }
+
+  // the descriptor stays owned by the caller
+  static shm_spscqueue attach(int fd) { return shm_spscqueue{fd}; }
+
+  // removes the name, the queue lives on while it is mapped
+  static void unlink(std::string const &name) {
+    if (::shm_unlink(name.c_str()) < 0)
+      detail::throw_errno("shm_unlink");
+  }
+
+  ~shm_spscqueue() {
+    ::munmap(header_, map_size_);
+    if (!(fd_ < 0))
+      ::close(fd_);
+  }
+
+  shm_spscqueue(shm_spscqueue const &) = delete;
+  shm_spscqueue &operator=(shm_spscqueue const &) = delete;
+
+  shm_spscqueue(shm_spscqueue &&) = delete;
+  shm_spscqueue &operator=(shm_spscqueue &&) = delete;
+
+  [[nodiscard]] uint32_t capacity() const { return size_ - 1; }
+
+  // the descriptor of the anonymous memory file, -1 for a named queue
+  [[nodiscard]] int fd() const noexcept { return fd_; }
+
+  std::optional<T> pop() noexcept {
+    auto const ch{header_->head.load(std::memory_order_relaxed)};
+    if (ch == tail_cached_) [[unlikely]] {
+      tail_cached_ = header_->tail.load(std::memory_order_acquire);
+      if (ch == tail_cached_)
+        return std::nullopt;
+    }
+
+    // the item is made of its bytes, T need not be default constructible
+    std::array<std::byte, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), items_ + ch, sizeof(T));
+    header_->head.store((ch + 1) % size_, std::memory_order_release);
+
+    return std::bit_cast<T>(bytes);
+  }
+
+  bool push(T const &v) noexcept {
+    auto const ct{header_->tail.load(std::memory_order_relaxed)};
+
+    auto const nt{(ct + 1) % size_};
+    if (nt == head_cached_) [[unlikely]] {
+      head_cached_ = header_->head.load(std::memory_order_acquire);
+      if (nt == head_cached_)
+        return false;
+    }
+
+    std::memcpy(items_ + ct, &v, sizeof(T));
+    header_->tail.store(nt, std::memory_order_release);
+
+    return true;
+  }
+
+  // copies as many items from the beginning of vs as there is room for,
+  // publishes them at once, returns the number of the items pushed
+  size_t push_bulk(std::span<T const> vs) noexcept {
+    auto const ct{header_->tail.load(std::memory_order_relaxed)};
+
+    auto n{capacity() - distance(head_cached_, ct)};
+    if (n < vs.size()) {
+      head_cached_ = header_->head.load(std::memory_order_acquire);
+      n = capacity() - distance(head_cached_, ct);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]]
+      return 0;
+
+    auto const n1{std::min(n, size_ - ct)};
+    std::memcpy(items_ + ct, vs.data(), n1 * sizeof(T));
+    std::memcpy(items_, vs.data() + n1, (n - n1) * sizeof(T));
+    header_->tail.store((ct + n) % size_, std::memory_order_release);
+
+    return n;
+  }
+
+  // copies as many items as available into the beginning of vs, releases
+  // their slots at once, returns the number of the items popped
+  size_t pop_bulk(std::span<T> vs) noexcept {
+    auto const ch{header_->head.load(std::memory_order_relaxed)};
+
+    auto n{distance(ch, tail_cached_)};
+    if (n < vs.size()) {
+      tail_cached_ = header_->tail.load(std::memory_order_acquire);
+      n = distance(ch, tail_cached_);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]]
+      return 0;
+
+    auto const n1{std::min(n, size_ - ch)};
+    std::memcpy(vs.data(), items_ + ch, n1 * sizeof(T));
+    std::memcpy(vs.data() + n1, items_, (n - n1) * sizeof(T));
+    header_->head.store((ch + n) % size_, std::memory_order_release);
+
+    return n;
+  }
+
+private:
+  static constexpr size_t items_offset() {
+    return (sizeof(detail::shm_spscheader) + alignof(T) - 1) / alignof(T) *
+           alignof(T);
+  }
+
+  static constexpr size_t map_size(size_t size) {
+    return items_offset() + size * sizeof(T);
+  }
+
+  // creates the queue in the empty memory file fd, the queue takes the
+  // descriptor over if keep_fd
+  shm_spscqueue(detail::fd_guard &fd, size_t capacity, bool keep_fd)
+      : size_(capacity + 1) {
+    if (0 == capacity)
+      throw std::length_error("xroost::shm_spscqueue: capacity is zero");
+    if (!(size_ < std::numeric_limits<uint32_t>::max()))
+      throw std::length_error("xroost::shm_spscqueue: capacity is too large");
+
+    if (::ftruncate(fd.fd, map_size(size_)) < 0)
+      detail::throw_errno("ftruncate");
+    map(fd.fd, map_size(size_));
+
+    header_->version = detail::shm_spscheader::layout_version;
+    header_->item_size = sizeof(T);
+    header_->item_align = alignof(T);
+    header_->size = size_;
+    header_->head.store(0, std::memory_order_relaxed);
+    header_->tail.store(0, std::memory_order_relaxed);
+    std::atomic_ref{header_->magic}.store(detail::shm_spscheader::magic_value,
+                                          std::memory_order_release);
+
+    if (keep_fd)
+      fd_ = fd.release();
+  }
+
+  // attaches to the queue created in the memory file fd
+  explicit shm_spscqueue(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+      detail::throw_errno("fstat");
+    if (static_cast<size_t>(st.st_size) < sizeof(detail::shm_spscheader))
+      throw std::runtime_error("xroost::shm_spscqueue: no queue header");
+    map(fd, st.st_size);
+
+    try {
+      if (std::atomic_ref{header_->magic}.load(std::memory_order_acquire) !=
+          detail::shm_spscheader::magic_value)
+        throw std::runtime_error("xroost::shm_spscqueue: no queue header");
+      if (header_->version != detail::shm_spscheader::layout_version)
+        throw std::runtime_error("xroost::shm_spscqueue: layout mismatch");
+      if (header_->item_size != sizeof(T) || header_->item_align != alignof(T))
+        throw std::runtime_error("xroost::shm_spscqueue: item type mismatch");
+      if (header_->size < 2 || map_size_ < map_size(header_->size))
+        throw std::runtime_error("xroost::shm_spscqueue: truncated queue");
+    } catch (...) {
+      ::munmap(header_, map_size_);
+      throw;
+    }
+
+    size_ = header_->size;
+    // nothing to pop and no room to push until the shared indices are read
+    tail_cached_ = header_->head.load(std::memory_order_relaxed);
+    head_cached_ = (header_->tail.load(std::memory_order_relaxed) + 1) % size_;
+  }
+
+  void map(int fd, size_t size) {
+    auto *const p{
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+    if (MAP_FAILED == p)
+      detail::throw_errno("mmap");
+
+    header_ = static_cast<detail::shm_spscheader *>(p);
+    items_ = reinterpret_cast<T *>(static_cast<std::byte *>(p) +
+                                   items_offset());
+    map_size_ = size;
+  }
+
+  // the number of steps to take from the position 'from' to reach 'to'
+  size_t distance(size_t from, size_t to) const {
+    return to < from ? to + size_ - from : to - from;
+  }
+
+  // consumer's local copy of the shared tail
+  alignas(detail::shm_line_size) uint32_t tail_cached_{};
+  // producer's local copy of the shared head
+  alignas(detail::shm_line_size) uint32_t head_cached_{};
+  alignas(detail::shm_line_size) size_t size_{};
+  detail::shm_spscheader *header_{};
+  T *items_{};
+  size_t map_size_{};
+  int fd_{-1};
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <xroost/utility/aligned_storage.hpp>
+
+#include "detail.hpp"
+
+namespace xroost::detail {
+
+// the head of a cursor no consumer is registered with, the producer does not
+// wait for it as it is never the slowest one
+inline constexpr size_t broadcast_inactive{
+    std::numeric_limits<size_t>::max()};
+
+struct alignas(hardware_destructive_interference_size) broadcast_cursor {
+  // the position of the next item to be read by the consumer
+  std::atomic_size_t head{broadcast_inactive};
+  // consumer's local copy of the producer's tail
+  size_t tail_cached{};
+};
+
+// claims an inactive cursor for a consumer starting at the producer's tail:
+// the cursor is claimed at the tail read first and moved to the tail read
+// once it is published. The seq_cst claim and read pair with the fence the
+// producer puts in slowest() between its tail stores and its reads of the
+// cursors: either the producer sees the cursor claimed and waits for it, or
+// the second read sees every tail stored before the producer looked, so
+// that the producer's head_cached_ is not past the consumer's start
+inline std::optional<size_t>
+broadcast_register(broadcast_cursor *cursors, size_t count,
+                   std::atomic_size_t const &tail) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    auto &cursor{cursors[i]};
+    auto head{broadcast_inactive};
+    if (cursor.head.load(std::memory_order_relaxed) != head ||
+        !cursor.head.compare_exchange_strong(
+            head, tail.load(std::memory_order_seq_cst),
+            std::memory_order_seq_cst))
+      continue;
+
+    cursor.tail_cached = tail.load(std::memory_order_seq_cst);
+    cursor.head.store(cursor.tail_cached, std::memory_order_seq_cst);
+    return i;
+  }
+  return std::nullopt;
+}
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// every item pushed is seen by each of up to Consumers consumers registered,
+// a consumer is identified by the index of its cursor it gets on registering
+// and reads at its own pace from the items pushed since then; the producer
+// refuses to push when the slowest consumer registered lags N items behind
+template <typename T, size_t N, size_t Consumers>
+  requires(std::copy_constructible<T> && std::destructible<T>)
+class static_spmcbroadcast {
+  static_assert(0 < N, "xroost::static_spmcbroadcast: capacity is zero");
+
+public:
+  static_spmcbroadcast() = default;
+  ~static_spmcbroadcast() {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+    for (auto pos{ct - std::min(ct, size_t{N})}; pos != ct; ++pos)
+      std::destroy_at(item(pos));
+  }
+
+  static_spmcbroadcast(static_spmcbroadcast const &) = delete;
+  static_spmcbroadcast &operator=(static_spmcbroadcast const &) = delete;
+
+  static_spmcbroadcast(static_spmcbroadcast &&) = delete;
+  static_spmcbroadcast &operator=(static_spmcbroadcast &&) = delete;
+
+  [[nodiscard]] static constexpr uint32_t capacity() { return N; }
+  [[nodiscard]] static constexpr uint32_t consumers() { return Consumers; }
+
+  // no index if there are Consumers consumers registered already
+  std::optional<size_t> register_consumer() noexcept {
+    return detail::broadcast_register(cursors_.data(), cursors_.size(), tail_);
+  }
+
+  // the consumer is not to pop any longer, the producer stops waiting for it
+  void unregister_consumer(size_t consumer) noexcept {
+    cursors_[consumer].head.store(detail::broadcast_inactive,
+                                  std::memory_order_release);
+  }
+
+  // by a consumer registered only
+  std::optional<T> pop(size_t consumer) noexcept(
+      std::is_nothrow_copy_constructible_v<T>) {
+    std::optional<T> v;
+
+    auto &cursor{cursors_[consumer]};
+    auto const ch{cursor.head.load(std::memory_order_relaxed)};
+    if (ch == cursor.tail_cached) [[unlikely]] {
+      cursor.tail_cached = tail_.load(std::memory_order_acquire);
+      if (ch == cursor.tail_cached)
+        return v;
+    }
+
+    v.emplace(*item(ch));
+    cursor.head.store(ch + 1, std::memory_order_release);
+
+    return v;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T> &&
+                                 std::is_nothrow_destructible_v<T>) {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                            std::is_nothrow_destructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...> &&
+      std::is_nothrow_destructible_v<T>) {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    if (ct - head_cached_ == capacity()) [[unlikely]] {
+      head_cached_ = slowest();
+      if (ct - head_cached_ == capacity())
+        return false;
+    }
+
+    // every consumer is done with the item pushed a lap ago in this slot
+    if (!(ct < capacity()))
+      std::destroy_at(item(ct));
+    std::construct_at(storage(ct), std::forward<Args>(args)...);
+    tail_.store(ct + 1, std::memory_order_release);
+
+    return true;
+  }
+
+private:
+  static size_t index_of(size_t pos) {
+    if constexpr (detail::is_power_of_2(capacity()))
+      return pos & (capacity() - 1);
+    else
+      return pos % capacity();
+  }
+
+  // the position of the slowest consumer
+  size_t slowest() const noexcept {
+    // see detail::broadcast_register
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto head{tail_.load(std::memory_order_relaxed)};
+    for (auto const &cursor : cursors_)
+      head = std::min(head, cursor.head.load(std::memory_order_acquire));
+    return head;
+  }
+
+  T *storage(size_t pos) noexcept {
+    return reinterpret_cast<T *>(items_[index_of(pos)].data);
+  }
+  T *item(size_t pos) noexcept { return std::launder(storage(pos)); }
+
+  std::array<detail::broadcast_cursor, consumers()> cursors_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t tail_;
+  // producer's local copy of the slowest consumer's head
+  alignas(detail::hardware_destructive_interference_size)
+      size_t head_cached_{};
+  alignas(detail::hardware_destructive_interference_size)
+      std::array<aligned_storage_t<T>, capacity()> items_;
+};
+
+template <typename T>
+  requires(std::copy_constructible<T> && std::destructible<T>)
+class spmcbroadcast {
+public:
+  spmcbroadcast(size_t capacity, size_t consumers)
+      : capacity_(capacity), consumers_(consumers),
+        cursors_(std::make_unique<detail::broadcast_cursor[]>(consumers_)),
+        items_(std::make_unique_for_overwrite<aligned_storage_t<T>[]>(
+            capacity_)) {
+    if (0 == capacity_)
+      throw std::length_error("xroost::spmcbroadcast: capacity is zero");
+  }
+  ~spmcbroadcast() {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+    for (auto pos{ct - std::min(ct, capacity_)}; pos != ct; ++pos)
+      std::destroy_at(item(pos));
+  }
+
+  spmcbroadcast(spmcbroadcast const &) = delete;
+  spmcbroadcast &operator=(spmcbroadcast const &) = delete;
+
+  spmcbroadcast(spmcbroadcast &&) = delete;
+  spmcbroadcast &operator=(spmcbroadcast &&) = delete;
+
+  [[nodiscard]] uint32_t capacity() const { return capacity_; }
+  [[nodiscard]] uint32_t consumers() const { return consumers_; }
+
+  // no index if there are consumers() consumers registered already
+  std::optional<size_t> register_consumer() noexcept {
+    return detail::broadcast_register(cursors_.get(), consumers_, tail_);
+  }
+
+  // the consumer is not to pop any longer, the producer stops waiting for it
+  void unregister_consumer(size_t consumer) noexcept {
+    cursors_[consumer].head.store(detail::broadcast_inactive,
+                                  std::memory_order_release);
+  }
+
+  // by a consumer registered only
+  std::optional<T> pop(size_t consumer) noexcept(
+      std::is_nothrow_copy_constructible_v<T>) {
+    std::optional<T> v;
+
+    auto &cursor{cursors_[consumer]};
+    auto const ch{cursor.head.load(std::memory_order_relaxed)};
+    if (ch == cursor.tail_cached) [[unlikely]] {
+      cursor.tail_cached = tail_.load(std::memory_order_acquire);
+      if (ch == cursor.tail_cached)
+        return v;
+    }
+
+    v.emplace(*item(ch));
+    cursor.head.store(ch + 1, std::memory_order_release);
+
+    return v;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T> &&
+                                 std::is_nothrow_destructible_v<T>) {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                            std::is_nothrow_destructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...> &&
+      std::is_nothrow_destructible_v<T>) {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    if (ct - head_cached_ == capacity_) [[unlikely]] {
+      head_cached_ = slowest();
+      if (ct - head_cached_ == capacity_)
+        return false;
+    }
+
+    // every consumer is done with the item pushed a lap ago in this slot
+    if (!(ct < capacity_))
+      std::destroy_at(item(ct));
+    std::construct_at(storage(ct), std::forward<Args>(args)...);
+    tail_.store(ct + 1, std::memory_order_release);
+
+    return true;
+  }
+
+private:
+  // the position of the slowest consumer
+  size_t slowest() const noexcept {
+    // see detail::broadcast_register
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto head{tail_.load(std::memory_order_relaxed)};
+    for (size_t i = 0; i < consumers_; ++i)
+      head = std::min(head, cursors_[i].head.load(std::memory_order_acquire));
+    return head;
+  }
+
+  T *storage(size_t pos) noexcept {
+    return reinterpret_cast<T *>(items_[pos % capacity_].data);
+  }
+  T *item(size_t pos) noexcept { return std::launder(storage(pos)); }
+
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_size_t tail_;
+  // producer's local copy of the slowest consumer's head
+  alignas(detail::hardware_destructive_interference_size)
+      size_t head_cached_{};
+  size_t const capacity_;
+  size_t const consumers_;
+  std::unique_ptr<detail::broadcast_cursor[]> cursors_;
+  std::unique_ptr<aligned_storage_t<T>[]> items_;
+};
+
+} // namespace xroost::lockless
@@ -3,24 +3,55 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <concepts>
+#include <memory>
 #include <new>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <type_traits>
-#include <vector>
+#include <utility>
+
+#include <xroost/utility/aligned_storage.hpp>
 
 #include "detail.hpp"
+#include "stats_policy.hpp"
+#include "wait_policy.hpp"
+
+namespace xroost::detail {
+
+// a slot is handed out to the producer for the position pos once its
+// sequence number equals pos, consumers release the slot by setting the
+// sequence number to the position the slot will be next written at
+template <typename T> struct spmcslot {
+  std::atomic_size_t seq;
+  aligned_storage_t<T> storage;
+};
+
+} // namespace xroost::detail
 
 namespace xroost::lockless {
 
-template <typename T, size_t N>
-  requires(std::default_initializable<T> && std::copy_constructible<T>)
+template <typename T, size_t N, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
 class static_spmcqueue {
+  static_assert(0 < N, "xroost::static_spmcqueue: capacity is zero");
+
 public:
-  static_spmcqueue() = default;
-  ~static_spmcqueue() = default;
+  static_spmcqueue() {
+    for (size_t i = 0; i < items_.size(); ++i)
+      items_[i].seq.store(i, std::memory_order_relaxed);
+  }
+  ~static_spmcqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ++ch)
+      std::destroy_at(item(ch));
+  }
 
   static_spmcqueue(static_spmcqueue const &) = delete;
   static_spmcqueue &operator=(static_spmcqueue const &) = delete;
@@ -30,60 +61,194 @@ public:
 
   [[nodiscard]] static constexpr uint32_t capacity() { return N; }
 
-  std::optional<T> pop() noexcept(std::is_nothrow_copy_constructible_v<T> &&
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
                                   std::is_nothrow_destructible_v<T>) {
     std::optional<T> v;
 
     auto ch{head_.load(std::memory_order_relaxed)};
-    do {
+    for (;; pop_stats_.retry()) {
       if (auto const ct{tail_.load(std::memory_order_acquire)}; ct == ch)
           [[unlikely]] {
-
-        v.reset();
-        break;
+        pop_stats_.miss();
+        return v;
       }
-      v.emplace(items_[ch]);
-    } while (!head_.compare_exchange_weak(ch, next_to(ch),
-                                          std::memory_order_acq_rel));
+      if (head_.compare_exchange_weak(ch, ch + 1, std::memory_order_acq_rel))
+        break;
+    }
+
+    // the item at ch is claimed, it is only this consumer that has access to
+    // it until its slot is released
+    auto &slot{items_[index_of(ch)]};
+    auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    slot.seq.store(ch + capacity(), std::memory_order_release);
+    push_waiters_.notify_one(slot.seq);
+    pop_stats_.count();
 
     return v;
   }
 
-  bool push(T const &v) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+  // claims up to vs.size() items at once and moves them into the beginning of
+  // vs, returns the number of the items popped
+  size_t pop_bulk(std::span<T> vs) noexcept(
+      std::is_nothrow_move_assignable_v<T> &&
+      std::is_nothrow_destructible_v<T>)
+    requires std::is_move_assignable_v<T>
+  {
+    size_t n;
+
+    // acquired as the CAS that moved it had seen the tail past it, so that
+    // the tail read next is not behind it
+    auto ch{head_.load(std::memory_order_acquire)};
+    for (;; pop_stats_.retry()) {
+      n = std::min(tail_.load(std::memory_order_acquire) - ch, vs.size());
+      if (0 == n) [[unlikely]] {
+        if (!vs.empty())
+          pop_stats_.miss();
+        return 0;
+      }
+      if (head_.compare_exchange_weak(ch, ch + n, std::memory_order_acq_rel))
+        break;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      auto &slot{items_[index_of(ch + i)]};
+      auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+      vs[i] = std::move(*p);
+      std::destroy_at(p);
+      slot.seq.store(ch + i + capacity(), std::memory_order_release);
+    }
+
+    if (push_waiters_.has_parked()) [[unlikely]] {
+      for (size_t i = 0; i < n; ++i)
+        items_[index_of(ch + i)].seq.notify_one();
+    }
+    pop_stats_.count(n);
+
+    return n;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
     auto const ct{tail_.load(std::memory_order_relaxed)};
 
-    auto const nt{next_to(ct)};
-    if (nt == head_.load(std::memory_order_relaxed)) [[unlikely]]
+    auto &slot{items_[index_of(ct)]};
+    if (slot.seq.load(std::memory_order_acquire) != ct) [[unlikely]] {
+      push_stats_.miss();
       return false;
-
-    items_[ct] = v;
-    tail_.store(nt, std::memory_order_release);
+    }
+
+    std::construct_at(reinterpret_cast<T *>(slot.storage.data),
+                      std::forward<Args>(args)...);
+    tail_.store(ct + 1, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    push_stats_.count();
+    if (push_stats_.sample()) {
+      auto const ch{head_.load(std::memory_order_relaxed)};
+      push_stats_.water(ch < ct + 1 ? ct + 1 - ch : 0);
+    }
 
     return true;
   }
 
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); }, [this] {
+      return std::pair{&tail_, tail_.load(std::memory_order_relaxed)};
+    }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait(
+        [&] { return emplace(std::forward<Args>(args)...); },
+        [this] {
+          auto &seq{
+              items_[index_of(tail_.load(std::memory_order_relaxed))].seq};
+          return std::pair{&seq, seq.load(std::memory_order_relaxed)};
+        });
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
 private:
-  static size_t next_to(size_t pos) {
-    if constexpr (detail::is_power_of_2(capacity() + 1))
-      return (pos + 1) & capacity();
+  static size_t index_of(size_t pos) {
+    if constexpr (detail::is_power_of_2(capacity()))
+      return pos & (capacity() - 1);
     else
-      return (pos + 1) % (capacity() + 1);
+      return pos % capacity();
   }
 
+  T *item(size_t pos) noexcept {
+    return std::launder(
+        reinterpret_cast<T *>(items_[index_of(pos)].storage.data));
+  }
+
+  // consumers' counters share the line they contend for anyway
   alignas(detail::hardware_destructive_interference_size)
-      std::atomic_uint32_t head_;
+      std::atomic_size_t head_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> pop_stats_;
   alignas(detail::hardware_destructive_interference_size)
-      std::atomic_uint32_t tail_;
+      std::atomic_size_t tail_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy> push_stats_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
   alignas(detail::hardware_destructive_interference_size)
-      std::array<T, capacity() + 1> items_;
+      std::array<detail::spmcslot<T>, capacity()> items_;
 };
 
-template <typename T>
-  requires(std::default_initializable<T> && std::copy_constructible<T>)
+template <typename T, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
 class spmcqueue {
 public:
-  explicit spmcqueue(size_t capacity) : items_(capacity + 1) {}
-  ~spmcqueue() = default;
+  explicit spmcqueue(size_t capacity)
+      : capacity_(capacity),
+        items_(std::make_unique<detail::spmcslot<T>[]>(capacity_)) {
+    if (0 == capacity_)
+      throw std::length_error("xroost::spmcqueue: capacity is zero");
+
+    for (size_t i = 0; i < capacity_; ++i)
+      items_[i].seq.store(i, std::memory_order_relaxed);
+  }
+  ~spmcqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ++ch)
+      std::destroy_at(item(ch));
+  }
 
   spmcqueue(spmcqueue const &) = delete;
   spmcqueue &operator=(spmcqueue const &) = delete;
@@ -91,46 +256,170 @@ public:
   spmcqueue(spmcqueue &&) = delete;
   spmcqueue &operator=(spmcqueue &&) = delete;
 
-  [[nodiscard]] uint32_t capacity() const { return items_.size() - 1; }
+  [[nodiscard]] uint32_t capacity() const { return capacity_; }
 
-  std::optional<T> pop() noexcept(std::is_nothrow_copy_constructible_v<T> &&
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
                                   std::is_nothrow_destructible_v<T>) {
     std::optional<T> v;
 
     auto ch{head_.load(std::memory_order_relaxed)};
-    do {
+    for (;; pop_stats_.retry()) {
       if (auto const ct{tail_.load(std::memory_order_acquire)}; ct == ch)
           [[unlikely]] {
-
-        v.reset();
-        break;
+        pop_stats_.miss();
+        return v;
       }
-      v.emplace(items_[ch]);
-    } while (!head_.compare_exchange_weak(ch, (ch + 1) % items_.size(),
-                                          std::memory_order_acq_rel));
+      if (head_.compare_exchange_weak(ch, ch + 1, std::memory_order_acq_rel))
+        break;
+    }
+
+    // the item at ch is claimed, it is only this consumer that has access to
+    // it until its slot is released
+    auto &slot{items_[index_of(ch)]};
+    auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    slot.seq.store(ch + capacity_, std::memory_order_release);
+    push_waiters_.notify_one(slot.seq);
+    pop_stats_.count();
 
     return v;
   }
 
-  bool push(T const &v) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+  // claims up to vs.size() items at once and moves them into the beginning of
+  // vs, returns the number of the items popped
+  size_t pop_bulk(std::span<T> vs) noexcept(
+      std::is_nothrow_move_assignable_v<T> &&
+      std::is_nothrow_destructible_v<T>)
+    requires std::is_move_assignable_v<T>
+  {
+    size_t n;
+
+    // acquired as the CAS that moved it had seen the tail past it, so that
+    // the tail read next is not behind it
+    auto ch{head_.load(std::memory_order_acquire)};
+    for (;; pop_stats_.retry()) {
+      n = std::min(tail_.load(std::memory_order_acquire) - ch, vs.size());
+      if (0 == n) [[unlikely]] {
+        if (!vs.empty())
+          pop_stats_.miss();
+        return 0;
+      }
+      if (head_.compare_exchange_weak(ch, ch + n, std::memory_order_acq_rel))
+        break;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      auto &slot{items_[index_of(ch + i)]};
+      auto *const p{std::launder(reinterpret_cast<T *>(slot.storage.data))};
+      vs[i] = std::move(*p);
+      std::destroy_at(p);
+      slot.seq.store(ch + i + capacity_, std::memory_order_release);
+    }
+
+    if (push_waiters_.has_parked()) [[unlikely]] {
+      for (size_t i = 0; i < n; ++i)
+        items_[index_of(ch + i)].seq.notify_one();
+    }
+    pop_stats_.count(n);
+
+    return n;
+  }
+
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
     auto const ct{tail_.load(std::memory_order_relaxed)};
 
-    auto const nt{(ct + 1) % items_.size()};
-    if (nt == head_.load(std::memory_order_relaxed)) [[unlikely]]
+    auto &slot{items_[index_of(ct)]};
+    if (slot.seq.load(std::memory_order_acquire) != ct) [[unlikely]] {
+      push_stats_.miss();
       return false;
-
-    items_[ct] = v;
-    tail_.store(nt, std::memory_order_release);
+    }
+
+    std::construct_at(reinterpret_cast<T *>(slot.storage.data),
+                      std::forward<Args>(args)...);
+    tail_.store(ct + 1, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    push_stats_.count();
+    if (push_stats_.sample()) {
+      auto const ch{head_.load(std::memory_order_relaxed)};
+      push_stats_.water(ch < ct + 1 ? ct + 1 - ch : 0);
+    }
 
     return true;
   }
 
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); }, [this] {
+      return std::pair{&tail_, tail_.load(std::memory_order_relaxed)};
+    }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait(
+        [&] { return emplace(std::forward<Args>(args)...); },
+        [this] {
+          auto &seq{
+              items_[index_of(tail_.load(std::memory_order_relaxed))].seq};
+          return std::pair{&seq, seq.load(std::memory_order_relaxed)};
+        });
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
 private:
+  size_t index_of(size_t pos) const { return pos % capacity_; }
+
+  T *item(size_t pos) noexcept {
+    return std::launder(
+        reinterpret_cast<T *>(items_[index_of(pos)].storage.data));
+  }
+
+  // consumers' counters share the line they contend for anyway
   alignas(detail::hardware_destructive_interference_size)
-      std::atomic_uint32_t head_;
+      std::atomic_size_t head_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy, true> pop_stats_;
   alignas(detail::hardware_destructive_interference_size)
-      std::atomic_uint32_t tail_;
-  alignas(detail::hardware_destructive_interference_size) std::vector<T> items_;
+      std::atomic_size_t tail_;
+  [[no_unique_address]] detail::sidestats<StatsPolicy> push_stats_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
+  alignas(detail::hardware_destructive_interference_size) size_t const
+      capacity_;
+  std::unique_ptr<detail::spmcslot<T>[]> items_;
 };
 
 } // namespace xroost::lockless
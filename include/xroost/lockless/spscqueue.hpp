@@ -3,24 +3,37 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <concepts>
+#include <memory>
 #include <new>
 #include <optional>
+#include <span>
 #include <type_traits>
-#include <vector>
+#include <utility>
+
+#include <xroost/utility/aligned_storage.hpp>
 
 #include "detail.hpp"
+#include "stats_policy.hpp"
+#include "wait_policy.hpp"
 
 namespace xroost::lockless {
 
-template <typename T, size_t N>
-  requires(std::default_initializable<T> && std::copy_constructible<T>)
+template <typename T, size_t N, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
 class static_spscqueue {
 public:
   static_spscqueue() = default;
-  ~static_spscqueue() = default;
+  ~static_spscqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ch = next_to(ch))
+      std::destroy_at(item(ch));
+  }
 
   static_spscqueue(static_spscqueue const &) = delete;
   static_spscqueue &operator=(static_spscqueue const &) = delete;
@@ -30,35 +43,232 @@ public:
 
   [[nodiscard]] static constexpr uint32_t capacity() { return N; }
 
-  std::optional<T> pop() noexcept(std::is_nothrow_copy_constructible_v<T> &&
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
                                   std::is_nothrow_destructible_v<T>) {
     std::optional<T> v;
 
     auto const ch{head_.load(std::memory_order_relaxed)};
-    if (auto const ct{tail_.load(std::memory_order_acquire)}; ct != ch)
-        [[likely]] {
-
-      v = items_[ch];
-      head_.store(next_to(ch), std::memory_order_relaxed);
+    if (ch == tail_cached_) [[unlikely]] {
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+      if (ch == tail_cached_) {
+        pop_stats_.miss();
+        return v;
+      }
     }
 
+    auto *const p{item(ch)};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    head_.store(next_to(ch), std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count();
+
     return v;
   }
 
-  bool push(T const &v) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
     auto const ct{tail_.load(std::memory_order_relaxed)};
 
     auto const nt{next_to(ct)};
-    if (nt == head_.load(std::memory_order_relaxed)) [[unlikely]]
-      return false;
+    if (nt == head_cached_) [[unlikely]] {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      if (nt == head_cached_) {
+        push_stats_.miss();
+        return false;
+      }
+    }
 
-    items_[ct] = v;
+    std::construct_at(storage(ct), std::forward<Args>(args)...);
     tail_.store(nt, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes(nt, 1);
 
     return true;
   }
 
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); }, [this] {
+      return std::pair{&tail_, tail_.load(std::memory_order_relaxed)};
+    }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait(
+        [&] { return emplace(std::forward<Args>(args)...); },
+        [this] {
+          return std::pair{&head_, head_.load(std::memory_order_relaxed)};
+        });
+  }
+
+  // copies as many items from the beginning of vs as there is room for,
+  // publishes them at once, returns the number of the items pushed
+  size_t push_bulk(std::span<T const> vs) noexcept(
+      std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    auto n{capacity() - distance(head_cached_, ct)};
+    if (n < vs.size()) {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      n = capacity() - distance(head_cached_, ct);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]] {
+      if (!vs.empty())
+        push_stats_.miss();
+      return 0;
+    }
+
+    for (auto pos{ct}; auto const &v : vs.first(n)) {
+      std::construct_at(storage(pos), v);
+      pos = next_to(pos);
+    }
+    tail_.store(advance(ct, n), std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes(advance(ct, n), n);
+
+    return n;
+  }
+
+  // moves as many items as available into the beginning of vs, releases
+  // their slots at once, returns the number of the items popped
+  size_t pop_bulk(std::span<T> vs) noexcept(
+      std::is_nothrow_move_assignable_v<T> &&
+      std::is_nothrow_destructible_v<T>)
+    requires std::is_move_assignable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+
+    auto n{distance(ch, tail_cached_)};
+    if (n < vs.size()) {
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+      n = distance(ch, tail_cached_);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]] {
+      if (!vs.empty())
+        pop_stats_.miss();
+      return 0;
+    }
+
+    for (auto pos{ch}; auto &v : vs.first(n)) {
+      auto *const p{item(pos)};
+      v = std::move(*p);
+      std::destroy_at(p);
+      pos = next_to(pos);
+    }
+    head_.store(advance(ch, n), std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count(n);
+
+    return n;
+  }
+
+  // returns writable slots for n items to be constructed in place and
+  // published by commit(n), the second span is only non-empty if the slots
+  // wrap around the end of the ring; both spans are empty if there is no
+  // room for n items
+  std::array<std::span<T>, 2> try_reserve(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    if (capacity() - distance(head_cached_, ct) < n) {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      if (capacity() - distance(head_cached_, ct) < n) [[unlikely]] {
+        push_stats_.miss();
+        return {};
+      }
+    }
+
+    auto const n1{std::min(n, capacity() + size_t{1} - ct)};
+    return {std::span{storage(ct), n1}, std::span{storage(0), n - n1}};
+  }
+
+  // publishes n items written into the slots given by try_reserve()
+  void commit(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+    tail_.store(advance(ct, n), std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes(advance(ct, n), n);
+  }
+
+  // returns up to n items available for reading in place, the second span
+  // is only non-empty if the items wrap around the end of the ring; the
+  // items stay in the queue until release() is called
+  std::array<std::span<T const>, 2> peek(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+
+    if (distance(ch, tail_cached_) < n)
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+    if (0 != n && 0 == distance(ch, tail_cached_)) [[unlikely]]
+      pop_stats_.miss();
+    n = std::min(n, distance(ch, tail_cached_));
+
+    auto const n1{std::min(n, capacity() + size_t{1} - ch)};
+    return {std::span<T const>{item(ch), n1},
+            std::span<T const>{item(0), n - n1}};
+  }
+
+  // gives the slots of n items obtained by peek() back to the producer
+  void release(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+    head_.store(advance(ch, n), std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count(n);
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
 private:
+  // counts n items just pushed, ct is the tail past them
+  void count_pushes(size_t ct, size_t n) noexcept {
+    push_stats_.count(n);
+    if (push_stats_.sample(n))
+      push_stats_.water(distance(head_.load(std::memory_order_relaxed), ct));
+  }
+
   static size_t next_to(size_t pos) {
     if constexpr (detail::is_power_of_2(capacity() + 1))
       return (pos + 1) & capacity();
@@ -66,20 +276,55 @@ private:
       return (pos + 1) % (capacity() + 1);
   }
 
+  static size_t advance(size_t pos, size_t n) {
+    if constexpr (detail::is_power_of_2(capacity() + 1))
+      return (pos + n) & capacity();
+    else
+      return (pos + n) % (capacity() + 1);
+  }
+
+  // the number of steps to take from the position 'from' to reach 'to'
+  static size_t distance(size_t from, size_t to) {
+    return to < from ? to + (capacity() + 1) - from : to - from;
+  }
+
+  T *storage(size_t pos) noexcept {
+    return reinterpret_cast<T *>(items_[pos].data);
+  }
+  T *item(size_t pos) noexcept { return std::launder(storage(pos)); }
+
   alignas(detail::hardware_destructive_interference_size)
       std::atomic_uint32_t head_;
+  // consumer's local copy of tail_ and counters
+  alignas(detail::hardware_destructive_interference_size)
+      uint32_t tail_cached_{};
+  [[no_unique_address]] detail::sidestats<StatsPolicy> pop_stats_;
   alignas(detail::hardware_destructive_interference_size)
       std::atomic_uint32_t tail_;
+  // producer's local copy of head_ and counters
+  alignas(detail::hardware_destructive_interference_size)
+      uint32_t head_cached_{};
+  [[no_unique_address]] detail::sidestats<StatsPolicy> push_stats_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
   alignas(detail::hardware_destructive_interference_size)
-      std::array<T, capacity() + 1> items_;
+      std::array<aligned_storage_t<T>, capacity() + 1> items_;
 };
 
-template <typename T>
-  requires(std::default_initializable<T> && std::copy_constructible<T>)
+template <typename T, typename WaitPolicy = nonblocking,
+          typename StatsPolicy = no_stats>
+  requires(std::move_constructible<T> && std::destructible<T>)
 class spscqueue {
 public:
-  explicit spscqueue(size_t capacity) : items_(capacity + 1) {}
-  ~spscqueue() = default;
+  explicit spscqueue(size_t capacity)
+      : size_(capacity + 1),
+        items_(std::make_unique_for_overwrite<aligned_storage_t<T>[]>(size_)) {}
+  ~spscqueue() {
+    for (auto ch{head_.load(std::memory_order_relaxed)},
+         ct{tail_.load(std::memory_order_relaxed)};
+         ch != ct; ch = (ch + 1) % size_)
+      std::destroy_at(item(ch));
+  }
 
   spscqueue(spscqueue const &) = delete;
   spscqueue &operator=(spscqueue const &) = delete;
@@ -87,42 +332,260 @@ public:
   spscqueue(spscqueue &&) = delete;
   spscqueue &operator=(spscqueue &&) = delete;
 
-  [[nodiscard]] uint32_t capacity() const { return items_.size() - 1; }
+  [[nodiscard]] uint32_t capacity() const { return size_ - 1; }
 
-  std::optional<T> pop() noexcept(std::is_nothrow_copy_constructible_v<T> &&
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
                                   std::is_nothrow_destructible_v<T>) {
     std::optional<T> v;
 
     auto const ch{head_.load(std::memory_order_relaxed)};
-    if (auto const ct{tail_.load(std::memory_order_acquire)}; ct != ch)
-        [[likely]] {
-
-      v = items_[ch];
-      head_.store((ch + 1) % items_.size(), std::memory_order_relaxed);
+    if (ch == tail_cached_) [[unlikely]] {
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+      if (ch == tail_cached_) {
+        pop_stats_.miss();
+        return v;
+      }
     }
 
+    auto *const p{item(ch)};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+    head_.store((ch + 1) % size_, std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count();
+
     return v;
   }
 
-  bool push(T const &v) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+  bool push(T const &v) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    return emplace(v);
+  }
+
+  bool push(T &&v) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    return emplace(std::move(v));
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  bool emplace(Args &&...args) noexcept(
+      std::is_nothrow_constructible_v<T, Args...>) {
     auto const ct{tail_.load(std::memory_order_relaxed)};
 
-    auto const nt{(ct + 1) % items_.size()};
-    if (nt == head_.load(std::memory_order_relaxed)) [[unlikely]]
-      return false;
+    auto const nt{(ct + 1) % size_};
+    if (nt == head_cached_) [[unlikely]] {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      if (nt == head_cached_) {
+        push_stats_.miss();
+        return false;
+      }
+    }
 
-    items_[ct] = v;
+    std::construct_at(storage(ct), std::forward<Args>(args)...);
     tail_.store(nt, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes(nt, 1);
 
     return true;
   }
 
+  T pop_wait()
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    return std::move(*pop_waiters_.wait([this] { return pop(); }, [this] {
+      return std::pair{&tail_, tail_.load(std::memory_order_relaxed)};
+    }));
+  }
+
+  void push_wait(T const &v)
+    requires(detail::blocking_policy<WaitPolicy> && std::copy_constructible<T>)
+  {
+    emplace_wait(v);
+  }
+
+  void push_wait(T &&v)
+    requires detail::blocking_policy<WaitPolicy>
+  {
+    emplace_wait(std::move(v));
+  }
+
+  template <typename... Args>
+    requires(detail::blocking_policy<WaitPolicy> &&
+             std::constructible_from<T, Args...>)
+  void emplace_wait(Args &&...args) {
+    push_waiters_.wait(
+        [&] { return emplace(std::forward<Args>(args)...); },
+        [this] {
+          return std::pair{&head_, head_.load(std::memory_order_relaxed)};
+        });
+  }
+
+  // copies as many items from the beginning of vs as there is room for,
+  // publishes them at once, returns the number of the items pushed
+  size_t push_bulk(std::span<T const> vs) noexcept(
+      std::is_nothrow_copy_constructible_v<T>)
+    requires std::copy_constructible<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    auto n{capacity() - distance(head_cached_, ct)};
+    if (n < vs.size()) {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      n = capacity() - distance(head_cached_, ct);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]] {
+      if (!vs.empty())
+        push_stats_.miss();
+      return 0;
+    }
+
+    for (auto pos{ct}; auto const &v : vs.first(n)) {
+      std::construct_at(storage(pos), v);
+      pos = (pos + 1) % size_;
+    }
+    tail_.store((ct + n) % size_, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes((ct + n) % size_, n);
+
+    return n;
+  }
+
+  // moves as many items as available into the beginning of vs, releases
+  // their slots at once, returns the number of the items popped
+  size_t pop_bulk(std::span<T> vs) noexcept(
+      std::is_nothrow_move_assignable_v<T> &&
+      std::is_nothrow_destructible_v<T>)
+    requires std::is_move_assignable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+
+    auto n{distance(ch, tail_cached_)};
+    if (n < vs.size()) {
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+      n = distance(ch, tail_cached_);
+    }
+    n = std::min(n, vs.size());
+    if (0 == n) [[unlikely]] {
+      if (!vs.empty())
+        pop_stats_.miss();
+      return 0;
+    }
+
+    for (auto pos{ch}; auto &v : vs.first(n)) {
+      auto *const p{item(pos)};
+      v = std::move(*p);
+      std::destroy_at(p);
+      pos = (pos + 1) % size_;
+    }
+    head_.store((ch + n) % size_, std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count(n);
+
+    return n;
+  }
+
+  // returns writable slots for n items to be constructed in place and
+  // published by commit(n), the second span is only non-empty if the slots
+  // wrap around the end of the ring; both spans are empty if there is no
+  // room for n items
+  std::array<std::span<T>, 2> try_reserve(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+
+    if (capacity() - distance(head_cached_, ct) < n) {
+      head_cached_ = head_.load(std::memory_order_acquire);
+      if (capacity() - distance(head_cached_, ct) < n) [[unlikely]] {
+        push_stats_.miss();
+        return {};
+      }
+    }
+
+    auto const n1{std::min(n, size_ - ct)};
+    return {std::span{storage(ct), n1}, std::span{storage(0), n - n1}};
+  }
+
+  // publishes n items written into the slots given by try_reserve()
+  void commit(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ct{tail_.load(std::memory_order_relaxed)};
+    tail_.store((ct + n) % size_, std::memory_order_release);
+    pop_waiters_.notify_one(tail_);
+    count_pushes((ct + n) % size_, n);
+  }
+
+  // returns up to n items available for reading in place, the second span
+  // is only non-empty if the items wrap around the end of the ring; the
+  // items stay in the queue until release() is called
+  std::array<std::span<T const>, 2> peek(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+
+    if (distance(ch, tail_cached_) < n)
+      tail_cached_ = tail_.load(std::memory_order_acquire);
+    if (0 != n && 0 == distance(ch, tail_cached_)) [[unlikely]]
+      pop_stats_.miss();
+    n = std::min(n, distance(ch, tail_cached_));
+
+    auto const n1{std::min(n, size_ - ch)};
+    return {std::span<T const>{item(ch), n1},
+            std::span<T const>{item(0), n - n1}};
+  }
+
+  // gives the slots of n items obtained by peek() back to the producer
+  void release(size_t n) noexcept
+    requires std::is_trivially_copyable_v<T>
+  {
+    auto const ch{head_.load(std::memory_order_relaxed)};
+    head_.store((ch + n) % size_, std::memory_order_release);
+    push_waiters_.notify_one(head_);
+    pop_stats_.count(n);
+  }
+
+  [[nodiscard]] queue_stats stats() const noexcept
+    requires detail::stats_policy<StatsPolicy>
+  {
+    return detail::make_stats(push_stats_, pop_stats_);
+  }
+
 private:
+  // counts n items just pushed, ct is the tail past them
+  void count_pushes(size_t ct, size_t n) noexcept {
+    push_stats_.count(n);
+    if (push_stats_.sample(n))
+      push_stats_.water(distance(head_.load(std::memory_order_relaxed), ct));
+  }
+
+  // the number of steps to take from the position 'from' to reach 'to'
+  size_t distance(size_t from, size_t to) const {
+    return to < from ? to + size_ - from : to - from;
+  }
+
+  T *storage(size_t pos) noexcept {
+    return reinterpret_cast<T *>(items_[pos].data);
+  }
+  T *item(size_t pos) noexcept { return std::launder(storage(pos)); }
+
   alignas(detail::hardware_destructive_interference_size)
       std::atomic_uint32_t head_;
+  // consumer's local copy of tail_ and counters
+  alignas(detail::hardware_destructive_interference_size)
+      uint32_t tail_cached_{};
+  [[no_unique_address]] detail::sidestats<StatsPolicy> pop_stats_;
   alignas(detail::hardware_destructive_interference_size)
       std::atomic_uint32_t tail_;
-  alignas(detail::hardware_destructive_interference_size) std::vector<T> items_;
+  // producer's local copy of head_ and counters
+  alignas(detail::hardware_destructive_interference_size)
+      uint32_t head_cached_{};
+  [[no_unique_address]] detail::sidestats<StatsPolicy> push_stats_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> pop_waiters_;
+  [[no_unique_address]] detail::waitstate<WaitPolicy> push_waiters_;
+  alignas(detail::hardware_destructive_interference_size) size_t const size_;
+  std::unique_ptr<aligned_storage_t<T>[]> items_;
 };
 
 } // namespace xroost::lockless
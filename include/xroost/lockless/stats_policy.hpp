@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <concepts>
+
+namespace xroost::lockless {
+
+// no counters are kept
+struct no_stats {};
+
+// each side of the queue counts its operations in the cache line it already
+// owns, so that counting adds no shared writes: the producer side counts
+// pushes, pushes failed since the queue was full and CAS retries, the
+// consumer side counts pops, pops missed since the queue was empty and CAS
+// retries; the producer samples the occupancy once in sample_period pushes
+// to track its high-water mark
+struct with_stats {
+  static constexpr uint64_t sample_period{64};
+};
+
+struct queue_stats {
+  uint64_t pushes;
+  uint64_t push_failures;
+  uint64_t push_retries;
+  uint64_t pops;
+  uint64_t pop_misses;
+  uint64_t pop_retries;
+  uint64_t high_water;
+};
+
+} // namespace xroost::lockless
+
+namespace xroost::detail {
+
+template <typename StatsPolicy>
+concept stats_policy = std::same_as<StatsPolicy, lockless::with_stats>;
+
+// the counters of one side of a queue, Shared tells the side is taken by
+// several threads at once
+template <typename StatsPolicy, bool Shared = false> struct sidestats {
+  void count(uint64_t = 1) noexcept {}
+  void miss() noexcept {}
+  void retry() noexcept {}
+  static constexpr bool sample(uint64_t = 1) noexcept { return false; }
+  void water(uint64_t) noexcept {}
+};
+
+template <bool Shared> struct sidestats<lockless::with_stats, Shared> {
+  void count(uint64_t n = 1) noexcept { bump(ops, n); }
+  void miss() noexcept { bump(misses, 1); }
+  void retry() noexcept { bump(retries, 1); }
+
+  // true once in sample_period operations, to be called after the last n
+  // operations have been counted
+  bool sample(uint64_t n = 1) const noexcept {
+    constexpr auto period{lockless::with_stats::sample_period};
+    auto const done{ops.load(std::memory_order_relaxed)};
+    return (done - n) / period != done / period;
+  }
+
+  void water(uint64_t occupancy) noexcept {
+    auto level{high_water.load(std::memory_order_relaxed)};
+    if constexpr (Shared) {
+      while (level < occupancy &&
+             !high_water.compare_exchange_weak(level, occupancy,
+                                               std::memory_order_relaxed)) {
+      }
+    } else if (level < occupancy) {
+      high_water.store(occupancy, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic_uint64_t ops;
+  std::atomic_uint64_t misses;
+  std::atomic_uint64_t retries;
+  std::atomic_uint64_t high_water;
+
+private:
+  static void bump(std::atomic_uint64_t &counter, uint64_t n) noexcept {
+    if constexpr (Shared)
+      counter.fetch_add(n, std::memory_order_relaxed);
+    else
+      counter.store(counter.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+  }
+};
+
+template <bool PushShared, bool PopShared>
+lockless::queue_stats
+make_stats(sidestats<lockless::with_stats, PushShared> const &push,
+           sidestats<lockless::with_stats, PopShared> const &pop) noexcept {
+  return {
+      .pushes = push.ops.load(std::memory_order_relaxed),
+      .push_failures = push.misses.load(std::memory_order_relaxed),
+      .push_retries = push.retries.load(std::memory_order_relaxed),
+      .pops = pop.ops.load(std::memory_order_relaxed),
+      .pop_misses = pop.misses.load(std::memory_order_relaxed),
+      .pop_retries = pop.retries.load(std::memory_order_relaxed),
+      .high_water = push.high_water.load(std::memory_order_relaxed),
+  };
+}
+
+} // namespace xroost::detail
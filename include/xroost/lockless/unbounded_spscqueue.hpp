@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <xroost/utility/aligned_storage.hpp>
+
+#include "detail.hpp"
+#include "spscqueue.hpp"
+
+namespace xroost::detail {
+
+template <typename T, size_t N> struct spscsegment {
+  // the number of items published in the segment and the segment to go on
+  // with once it is full, both are written by the producer only
+  alignas(hardware_destructive_interference_size) std::atomic_size_t tail;
+  std::atomic<spscsegment *> next;
+  alignas(hardware_destructive_interference_size)
+      std::array<aligned_storage_t<T>, N> items;
+};
+
+} // namespace xroost::detail
+
+namespace xroost::lockless {
+
+// the queue is a list of segments of SegmentSize items each, the producer
+// links a new segment when the current one is full and the consumer hands
+// the segments it is done with back to the producer through a free list of
+// up to spare_segments segments
+template <typename T, size_t SegmentSize = 1024>
+  requires(std::move_constructible<T> && std::destructible<T>)
+class unbounded_spscqueue {
+public:
+  explicit unbounded_spscqueue(size_t spare_segments = 8)
+      : head_segment_(new segment), tail_segment_(head_segment_),
+        free_(spare_segments) {}
+  ~unbounded_spscqueue() {
+    for (auto *seg{head_segment_}; seg;) {
+      auto const ct{seg->tail.load(std::memory_order_relaxed)};
+      for (auto ch{seg == head_segment_ ? head_ : 0}; ch != ct; ++ch)
+        std::destroy_at(item(seg, ch));
+      delete std::exchange(seg, seg->next.load(std::memory_order_relaxed));
+    }
+    while (auto seg{free_.pop()})
+      delete *seg;
+  }
+
+  unbounded_spscqueue(unbounded_spscqueue const &) = delete;
+  unbounded_spscqueue &operator=(unbounded_spscqueue const &) = delete;
+
+  unbounded_spscqueue(unbounded_spscqueue &&) = delete;
+  unbounded_spscqueue &operator=(unbounded_spscqueue &&) = delete;
+
+  [[nodiscard]] static constexpr uint32_t segment_size() { return SegmentSize; }
+
+  std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                  std::is_nothrow_destructible_v<T>) {
+    std::optional<T> v;
+
+    if (head_ == tail_cached_) [[unlikely]] {
+      tail_cached_ = head_segment_->tail.load(std::memory_order_acquire);
+      if (head_ == tail_cached_) {
+        if (head_ != segment_size())
+          return v;
+
+        auto *const next{head_segment_->next.load(std::memory_order_acquire)};
+        if (!next)
+          return v;
+
+        retire(std::exchange(head_segment_, next));
+        head_ = 0;
+        tail_cached_ = head_segment_->tail.load(std::memory_order_acquire);
+        if (head_ == tail_cached_)
+          return v;
+      }
+    }
+
+    auto *const p{item(head_segment_, head_++)};
+    v.emplace(std::move(*p));
+    std::destroy_at(p);
+
+    return v;
+  }
+
+  void push(T const &v)
+    requires std::copy_constructible<T>
+  {
+    emplace(v);
+  }
+
+  void push(T &&v) { emplace(std::move(v)); }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args...>
+  void emplace(Args &&...args) {
+    if (tail_ == segment_size()) [[unlikely]]
+      extend();
+
+    std::construct_at(reinterpret_cast<T *>(tail_segment_->items[tail_].data),
+                      std::forward<Args>(args)...);
+    tail_segment_->tail.store(++tail_, std::memory_order_release);
+  }
+
+private:
+  using segment = detail::spscsegment<T, SegmentSize>;
+
+  static T *item(segment *seg, size_t pos) noexcept {
+    return std::launder(reinterpret_cast<T *>(seg->items[pos].data));
+  }
+
+  // links an empty segment, a recycled one if there is any, after the full
+  // tail segment
+  void extend() {
+    segment *seg;
+    if (auto recycled{free_.pop()}) {
+      seg = *recycled;
+      seg->tail.store(0, std::memory_order_relaxed);
+      seg->next.store(nullptr, std::memory_order_relaxed);
+    } else {
+      seg = new segment;
+    }
+
+    tail_segment_->next.store(seg, std::memory_order_release);
+    tail_segment_ = seg;
+    tail_ = 0;
+  }
+
+  void retire(segment *seg) noexcept {
+    if (!free_.push(seg))
+      delete seg;
+  }
+
+  // consumer's segment, position in it and local copy of the segment's tail
+  alignas(detail::hardware_destructive_interference_size)
+      segment *head_segment_;
+  size_t head_{};
+  size_t tail_cached_{};
+  // producer's segment and position in it
+  alignas(detail::hardware_destructive_interference_size)
+      segment *tail_segment_;
+  size_t tail_{};
+  // segments the consumer is done with, on their way back to the producer
+  spscqueue<segment *> free_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <utility>
+
+#include "detail.hpp"
+
+namespace xroost::lockless {
+
+// push/pop only try once and report failure when the queue is full/empty
+struct nonblocking {};
+
+// in addition, push_wait/pop_wait are provided: they spin Spins times trying
+// to push/pop and then park the thread in std::atomic::wait until the other
+// side has made progress; the other side skips notifying unless there is
+// someone parked
+template <uint32_t Spins = 4096> struct blocking {
+  static constexpr uint32_t spins = Spins;
+};
+
+} // namespace xroost::lockless
+
+namespace xroost::detail {
+
+template <typename WaitPolicy> inline constexpr bool is_blocking_v{false};
+
+template <uint32_t Spins>
+inline constexpr bool is_blocking_v<lockless::blocking<Spins>>{true};
+
+// only the blocking policies have a waitstate that can wait
+template <typename WaitPolicy>
+concept blocking_policy = is_blocking_v<WaitPolicy>;
+
+template <typename WaitPolicy> struct waitstate {
+  static constexpr bool has_parked() noexcept { return false; }
+  template <typename A> void notify_one(A &) noexcept {}
+  template <typename A> void notify_all(A &) noexcept {}
+};
+
+template <uint32_t Spins>
+struct alignas(hardware_destructive_interference_size)
+    waitstate<lockless::blocking<Spins>> {
+  // to be called after the change the parked threads might wait for has been
+  // published
+  bool has_parked() const noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return parked_.load(std::memory_order_relaxed);
+  }
+
+  template <typename A> void notify_one(A &a) noexcept {
+    if (has_parked()) [[unlikely]]
+      a.notify_one();
+  }
+
+  template <typename A> void notify_all(A &a) noexcept {
+    if (has_parked()) [[unlikely]]
+      a.notify_all();
+  }
+
+  // calls op() until it succeeds and returns its result; watch() is called
+  // before every attempt and tells which atomic is changed by the progress
+  // on the other side and what its value is, the thread is parked on it
+  // once spinning is over
+  template <typename Op, typename Watch> auto wait(Op op, Watch watch) {
+    for (uint32_t spins{0};;) {
+      auto const [a, old]{watch()};
+      if (auto r{op()})
+        return r;
+
+      if (spins < Spins) {
+        ++spins;
+        cpu_relax();
+        continue;
+      }
+
+      parked_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      a->wait(old, std::memory_order_relaxed);
+      parked_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  std::atomic_uint32_t parked_;
+};
+
+// bumped by every change on one side, for the other side to park on when
+// no atomic of its own is sure to change: the one it looked at may have
+// moved on already
+template <typename WaitPolicy> struct waitcount {
+  void bump() noexcept {}
+};
+
+template <uint32_t Spins> struct waitcount<lockless::blocking<Spins>> {
+  void bump() noexcept { count_.fetch_add(1, std::memory_order_release); }
+  void notify_all() noexcept { count_.notify_all(); }
+
+  // what the watch() of waitstate::wait returns, loaded before the attempt
+  // so that any change after it shows
+  auto watch() noexcept {
+    return std::pair{&count_, count_.load(std::memory_order_acquire)};
+  }
+
+private:
+  std::atomic_uint32_t count_{0};
+};
+
+} // namespace xroost::detail
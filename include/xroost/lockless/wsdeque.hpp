@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "detail.hpp"
+
+namespace xroost::lockless {
+
+// Chase-Lev work-stealing deque: the owner pushes and pops items at the
+// bottom, any other thread steals them from the top; the ring grows twice as
+// large as soon as it gets full, the rings outgrown are kept until the deque
+// is destroyed since thieves might still be reading them
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class wsdeque {
+public:
+  explicit wsdeque(size_t capacity = 256)
+      : ring_(new ring(std::bit_ceil(std::max(capacity, size_t{2})))) {
+    rings_.emplace_back(ring_.load(std::memory_order_relaxed));
+  }
+  ~wsdeque() = default;
+
+  wsdeque(wsdeque const &) = delete;
+  wsdeque &operator=(wsdeque const &) = delete;
+
+  wsdeque(wsdeque &&) = delete;
+  wsdeque &operator=(wsdeque &&) = delete;
+
+  // owner only
+  void push(T v) {
+    auto const b{bottom_.load(std::memory_order_relaxed)};
+    auto const t{top_.load(std::memory_order_acquire)};
+    auto *r{ring_.load(std::memory_order_relaxed)};
+
+    if (!(b - t < static_cast<ptrdiff_t>(r->capacity())))
+      r = grow(r, t, b);
+
+    r->put(b, v);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  // owner only
+  std::optional<T> pop() noexcept {
+    std::optional<T> v;
+
+    auto const b{bottom_.load(std::memory_order_relaxed) - 1};
+    auto *const r{ring_.load(std::memory_order_relaxed)};
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (auto t{top_.load(std::memory_order_relaxed)}; t <= b) [[likely]] {
+      v = r->get(b);
+      if (t == b) {
+        // the last item, race thieves for it
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+          v.reset();
+        bottom_.store(b + 1, std::memory_order_relaxed);
+      }
+    } else {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return v;
+  }
+
+  // any thread
+  std::optional<T> steal() noexcept {
+    std::optional<T> v;
+
+    auto t{top_.load(std::memory_order_acquire)};
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const b{bottom_.load(std::memory_order_acquire)};
+
+    if (t < b) {
+      v = ring_.load(std::memory_order_acquire)->get(t);
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        v.reset();
+    }
+
+    return v;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return !(top_.load(std::memory_order_relaxed) <
+             bottom_.load(std::memory_order_relaxed));
+  }
+
+private:
+  class ring {
+  public:
+    explicit ring(size_t capacity)
+        : mask_(capacity - 1),
+          items_(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    T get(ptrdiff_t pos) const noexcept {
+      return items_[pos & mask_].load(std::memory_order_relaxed);
+    }
+
+    void put(ptrdiff_t pos, T v) noexcept {
+      items_[pos & mask_].store(v, std::memory_order_relaxed);
+    }
+
+  private:
+    size_t const mask_;
+    std::unique_ptr<std::atomic<T>[]> items_;
+  };
+
+  ring *grow(ring *r, ptrdiff_t t, ptrdiff_t b) {
+    auto *const nr{rings_.emplace_back(new ring(r->capacity() * 2)).get()};
+    for (auto pos{t}; pos != b; ++pos)
+      nr->put(pos, r->get(pos));
+    ring_.store(nr, std::memory_order_release);
+    return nr;
+  }
+
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic<ptrdiff_t> top_;
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic<ptrdiff_t> bottom_;
+  std::atomic<ring *> ring_;
+  // owner's rings, the current one included
+  std::vector<std::unique_ptr<ring>> rings_;
+};
+
+} // namespace xroost::lockless
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <xroost/lockless/detail.hpp>
+#include <xroost/lockless/wsdeque.hpp>
+
+namespace xroost::detail {
+
+// a piece of work forked to the pool, it lives in the stack frame of the one
+// who forked it and who does not return before the work is done
+struct pool_job {
+  explicit pool_job(void (*run)(pool_job *) noexcept, bool external = false)
+      : run(run), external(external) {}
+
+  void (*const run)(pool_job *) noexcept;
+  // the job has been forked by a thread out of the pool
+  bool const external;
+  std::exception_ptr error;
+  std::atomic_bool done;
+};
+
+template <typename F> struct pool_task : pool_job {
+  explicit pool_task(F &f, bool external = false)
+      : pool_job(&invoke, external), f(f) {}
+
+  static void invoke(pool_job *job) noexcept {
+    try {
+      std::invoke(static_cast<pool_task *>(job)->f);
+    } catch (...) {
+      job->error = std::current_exception();
+    }
+  }
+
+  F &f;
+};
+
+} // namespace xroost::detail
+
+namespace xroost {
+
+// a fixed number of workers, each owning a work-stealing deque: the work
+// forked by a worker goes to the bottom of its own deque and is taken back
+// from there unless an idle worker has stolen it from the top in the
+// meantime; the work coming from threads out of the pool is injected through
+// a shared queue. Waiting for the forked work to be done, a worker helps
+// doing any work available
+class thread_pool {
+public:
+  explicit thread_pool(size_t threads = std::thread::hardware_concurrency())
+      : size_(std::max(threads, size_t{1})),
+        deques_(std::make_unique<lockless::wsdeque<detail::pool_job *>[]>(
+            size_)) {
+    threads_.reserve(size_);
+    for (size_t i = 0; i < size_; ++i)
+      threads_.emplace_back([this, i] { work(i); });
+  }
+  ~thread_pool() {
+    stop_.store(true, std::memory_order_relaxed);
+    epoch_.fetch_add(1, std::memory_order_release);
+    epoch_.notify_all();
+    for (auto &t : threads_)
+      t.join();
+  }
+
+  thread_pool(thread_pool const &) = delete;
+  thread_pool &operator=(thread_pool const &) = delete;
+
+  thread_pool(thread_pool &&) = delete;
+  thread_pool &operator=(thread_pool &&) = delete;
+
+  [[nodiscard]] size_t size() const noexcept { return size_; }
+
+  // calls f() on one of the workers and waits for it to return, f is free to
+  // fork further; called by a worker, f() is just called in place
+  template <std::invocable F> void execute(F &&f) {
+    if (current_.pool == this) {
+      std::invoke(f);
+      return;
+    }
+
+    detail::pool_task<std::remove_reference_t<F>> root{f, true};
+    {
+      std::lock_guard lock{injected_mutex_};
+      injected_.push_back(&root);
+      injected_size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake();
+
+    for (;;) {
+      auto const joined{joined_.load(std::memory_order_acquire)};
+      if (root.done.load(std::memory_order_acquire))
+        break;
+      joined_.wait(joined, std::memory_order_acquire);
+    }
+
+    if (root.error)
+      std::rethrow_exception(root.error);
+  }
+
+  // calls f() and g(), possibly in parallel, and returns when both are done;
+  // an exception thrown by either of them is rethrown, f's one goes first
+  template <std::invocable F, std::invocable G> void fork_join(F &&f, G &&g) {
+    if (current_.pool != this) {
+      execute([&] { fork_join(f, g); });
+      return;
+    }
+
+    detail::pool_task<std::remove_reference_t<G>> forked{g};
+    deques_[current_.index].push(&forked);
+    wake();
+
+    std::exception_ptr error;
+    try {
+      std::invoke(f);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    join(forked);
+
+    if (error)
+      std::rethrow_exception(error);
+    if (forked.error)
+      std::rethrow_exception(forked.error);
+  }
+
+  // calls f(i) for every i in [first, last), the range is split in halves
+  // forked until they are not longer than grain
+  template <std::integral I, std::invocable<I> F>
+  void parallel_for(I first, I last, I grain, F &&f) {
+    if (!(std::max(grain, I{1}) < last - first)) {
+      for (; first < last; ++first)
+        std::invoke(f, first);
+      return;
+    }
+
+    auto const mid{static_cast<I>(first + (last - first) / 2)};
+    fork_join([&] { parallel_for(first, mid, grain, f); },
+              [&] { parallel_for(mid, last, grain, f); });
+  }
+
+  // the grain is chosen so that each worker gets 8 pieces of the range
+  template <std::integral I, std::invocable<I> F>
+  void parallel_for(I first, I last, F &&f) {
+    auto const grain{first < last ? static_cast<I>((last - first) / (size_ * 8))
+                                  : I{1}};
+    parallel_for(first, last, grain, std::forward<F>(f));
+  }
+
+private:
+  static constexpr uint32_t idle_spins = 4096;
+
+  struct worker_id {
+    thread_pool const *pool;
+    size_t index;
+  };
+
+  void work(size_t index) {
+    current_ = {this, index};
+
+    for (uint32_t spins{0};;) {
+      if (auto *const job{find_job(index)}) {
+        run(job);
+        spins = 0;
+        continue;
+      }
+
+      if (spins < idle_spins) {
+        ++spins;
+        detail::cpu_relax();
+        continue;
+      }
+
+      // no work for a while, go to sleep until some is pushed
+      auto const epoch{epoch_.load(std::memory_order_acquire)};
+      sleeping_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (stop_.load(std::memory_order_relaxed))
+        break;
+
+      if (auto *const job{find_job(index)}) {
+        sleeping_.fetch_sub(1, std::memory_order_relaxed);
+        run(job);
+      } else {
+        epoch_.wait(epoch, std::memory_order_acquire);
+        sleeping_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      spins = 0;
+    }
+  }
+
+  // own deque first, then the injected work, then other workers' deques
+  detail::pool_job *find_job(size_t index) {
+    if (auto job{deques_[index].pop()})
+      return *job;
+
+    if (injected_size_.load(std::memory_order_relaxed)) [[unlikely]] {
+      std::lock_guard lock{injected_mutex_};
+      if (!injected_.empty()) {
+        auto *const job{injected_.front()};
+        injected_.pop_front();
+        injected_size_.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+      }
+    }
+
+    for (size_t i = 1; i < size_; ++i) {
+      if (auto job{deques_[(index + i) % size_].steal()})
+        return *job;
+    }
+
+    return nullptr;
+  }
+
+  void run(detail::pool_job *job) {
+    job->run(job);
+
+    // the job is gone as soon as it is marked done
+    if (job->external) {
+      job->done.store(true, std::memory_order_release);
+      joined_.fetch_add(1, std::memory_order_release);
+      joined_.notify_all();
+    } else {
+      job->done.store(true, std::memory_order_release);
+    }
+  }
+
+  // helps doing any work available until the job is done
+  void join(detail::pool_job &job) {
+    for (uint32_t spins{0}; !job.done.load(std::memory_order_acquire);) {
+      if (auto *const other{find_job(current_.index)}) {
+        run(other);
+        spins = 0;
+      } else if (spins < idle_spins) {
+        ++spins;
+        detail::cpu_relax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // to be called after a job has been pushed
+  void wake() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) [[unlikely]] {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_one();
+    }
+  }
+
+  static inline thread_local worker_id current_{};
+
+  size_t const size_;
+  std::unique_ptr<lockless::wsdeque<detail::pool_job *>[]> deques_;
+  std::vector<std::thread> threads_;
+  alignas(detail::hardware_destructive_interference_size) std::mutex
+      injected_mutex_;
+  std::deque<detail::pool_job *> injected_;
+  std::atomic_size_t injected_size_;
+  // bumped to wake up the workers sleeping
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_uint32_t epoch_;
+  std::atomic_uint32_t sleeping_;
+  std::atomic_bool stop_;
+  // bumped when a job forked from out of the pool is done
+  alignas(detail::hardware_destructive_interference_size)
+      std::atomic_uint32_t joined_;
+};
+
+} // namespace xroost
@@ -4,14 +4,11 @@
 
 namespace xroost {
 
-template <typename T, size_t Align>
-#ifdef __clang__
-struct aligned_storage_impl {
+// GCC ignores alignas on an alias of an array type, hence wrapping the bytes
+// into a struct for every compiler
+template <typename T, size_t Align> struct aligned_storage_impl {
   alignas(Align) std::byte data[sizeof(T)];
 };
-#else
-using aligned_storage_impl = alignas(Align) std::byte[sizeof(T)];
-#endif
 
 template <typename T, size_t Align = alignof(T)> struct aligned_storage {
   static_assert(!(Align < alignof(T)));